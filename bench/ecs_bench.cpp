@@ -0,0 +1,794 @@
+//===--------------------------------------------------------------------------------------------===
+// ecs_bench.cpp - ECS benchmark suite
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+//
+// Usage: thermals_bench [--format=csv|json|table] [--quick] [--reps=N] [--filter=text]
+//
+// Every case runs against every storage backend, for a sweep of entity counts and component
+// sizes. Each row reports the best of N repetitions, in nanoseconds per operation (one entity
+// created, one component added, one entity visited...). Results go to stdout; CSV by default.
+//
+// The mask scan and noise cases time each instruction set the CPU supports, after checking its
+// output against the scalar reference; any difference fails the run.
+#include <ecs/archetype.hpp>
+#include <ecs/spatial.hpp>
+#include <ecs/world.hpp>
+#include <SimplexNoise.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace amyinorbit::ecs;
+
+// Benchmark components: [Slot] tells the primary, secondary and churn components apart, and
+// [Bytes] sweeps the component size.
+template <std::size_t Bytes, int Slot>
+struct Blob { float data[Bytes / sizeof(float)]; };
+
+template <std::size_t Bytes> using Primary = Blob<Bytes, 0>;
+template <std::size_t Bytes> using Secondary = Blob<Bytes, 1>;
+template <std::size_t Bytes> using Extra = Blob<Bytes, 2>;
+template <std::size_t Bytes> using SparseExtra = Blob<Bytes, 3>;
+
+// Particle with a payload of [Bytes], stored either as one struct or as one array per field.
+struct Vec3f { float x, y, z; };
+
+template <std::size_t Bytes>
+struct Particle {
+    Vec3f position;
+    Vec3f velocity;
+    Blob<Bytes, 4> payload;
+};
+
+template <std::size_t Bytes>
+struct SoAParticle : Particle<Bytes> {};
+
+template <std::size_t Bytes>
+struct ParticleRef {
+    ParticleRef(Vec3f* p, Vec3f* v, Blob<Bytes, 4>* b) : position(*p), velocity(*v), payload(*b) {}
+
+    ParticleRef& operator=(const SoAParticle<Bytes>& other) {
+        position = other.position;
+        velocity = other.velocity;
+        payload = other.payload;
+        return *this;
+    }
+
+    Vec3f& position;
+    Vec3f& velocity;
+    Blob<Bytes, 4>& payload;
+};
+
+namespace amyinorbit::ecs {
+    template <std::size_t Bytes>
+    struct soa_layout<SoAParticle<Bytes>> {
+        using fields = type_list<Vec3f, Vec3f, Blob<Bytes, 4>>;
+        using reference = ParticleRef<Bytes>;
+        using const_reference = const ParticleRef<Bytes>;
+    };
+}
+
+#define BENCH_COMPONENTS(Bytes, First)                                                             \
+    using Primary##Bytes = Primary<Bytes>;                                                         \
+    using Secondary##Bytes = Secondary<Bytes>;                                                     \
+    using Extra##Bytes = Extra<Bytes>;                                                             \
+    using SparseExtra##Bytes = SparseExtra<Bytes>;                                                 \
+    ECS_COMPONENT(Primary##Bytes, First);                                                          \
+    ECS_COMPONENT(Secondary##Bytes, First + 1);                                                    \
+    ECS_COMPONENT(Extra##Bytes, First + 2);                                                        \
+    ECS_COMPONENT(SparseExtra##Bytes, First + 3);                                                  \
+    using Particle##Bytes = Particle<Bytes>;                                                       \
+    using SoAParticle##Bytes = SoAParticle<Bytes>;                                                 \
+    ECS_COMPONENT(Particle##Bytes, First + 4);                                                     \
+    ECS_COMPONENT(SoAParticle##Bytes, First + 5)
+
+BENCH_COMPONENTS(4, 0);
+BENCH_COMPONENTS(16, 6);
+BENCH_COMPONENTS(64, 12);
+BENCH_COMPONENTS(256, 18);
+
+// Tag for the filter cases.
+struct Circling {};
+
+ECS_COMPONENT(Circling, 25);
+
+// Sphere for the spatial index cases.
+struct Located {
+    Point center;
+    float radius;
+};
+
+ECS_COMPONENT(Located, 24);
+
+namespace amyinorbit::ecs {
+    template <> struct spatial_traits<Located> {
+        static Point position(const Located& l) { return l.center; }
+        static float radius(const Located& l) { return l.radius; }
+    };
+}
+
+namespace amyinorbit::ecs {
+    template <std::size_t Bytes>
+    struct storage_for<SparseExtra<Bytes>> { using type = SparseStore<SparseExtra<Bytes>>; };
+}
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double elapsed_ns(Clock::time_point start) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    // Keeps the optimiser from dropping loops whose results are otherwise unused.
+    volatile float sink = 0.f;
+
+    struct Options {
+        enum Format { csv, json, table } format = csv;
+        bool quick = false;
+        int reps = 3;
+        std::string filter;
+    };
+
+    struct Result {
+        const char* name;
+        const char* backend;
+        std::size_t entities;
+        std::size_t bytes;
+        double ns_per_op;
+        std::size_t ops;
+    };
+
+    // Runs [setup] then [body] reps times and keeps the fastest body. [body] returns the number
+    // of operations it performed.
+    double best_of(int reps, std::size_t& ops,
+                   const std::function<void()>& setup,
+                   const std::function<std::size_t()>& body) {
+        double best = 0;
+        for(int i = 0; i < reps; ++i) {
+            setup();
+            auto start = Clock::now();
+            ops = body();
+            auto ns = elapsed_ns(start) / double(ops ? ops : 1);
+            if(i == 0 || ns < best) best = ns;
+        }
+        return best;
+    }
+
+    std::vector<std::size_t> shuffled(std::size_t count) {
+        std::vector<std::size_t> order(count);
+        for(std::size_t i = 0; i < count; ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+        return order;
+    }
+
+    // Uniform interface over the two entity managers, so the cases below are written once.
+    struct ChunkedBackend {
+        using Manager = World;
+        static constexpr const char* name = "chunked";
+
+        template <std::size_t B>
+        static std::size_t iterate1(World& world) {
+            std::size_t visited = 0;
+            for(auto [a]: world.with<Primary<B>>()) {
+                a.data[0] += 1.f;
+                ++visited;
+            }
+            return visited;
+        }
+
+        template <std::size_t B>
+        static std::size_t iterate2(World& world) {
+            std::size_t visited = 0;
+            for(auto [a, b]: world.with<Primary<B>, const Secondary<B>>()) {
+                a.data[0] += b.data[0];
+                ++visited;
+            }
+            return visited;
+        }
+
+        template <std::size_t B>
+        static std::size_t query2(World& world) {
+            std::size_t visited = 0;
+            for(auto [a, b]: world.query<Primary<B>, const Secondary<B>>()) {
+                a.data[0] += b.data[0];
+                ++visited;
+            }
+            return visited;
+        }
+
+        template <std::size_t B>
+        static std::size_t par_iterate2(World& world) {
+            world.with<Primary<B>, const Secondary<B>>().par_each(
+                [](Primary<B>& a, const Secondary<B>& b) { a.data[0] += b.data[0]; });
+            return world.size();
+        }
+    };
+
+    struct ArchetypeBackend {
+        using Manager = ArchetypeWorld;
+        static constexpr const char* name = "archetype";
+
+        template <std::size_t B>
+        static std::size_t iterate1(ArchetypeWorld& world) {
+            std::size_t visited = 0;
+            world.with<Primary<B>>().each([&](Primary<B>& a) {
+                a.data[0] += 1.f;
+                ++visited;
+            });
+            return visited;
+        }
+
+        template <std::size_t B>
+        static std::size_t iterate2(ArchetypeWorld& world) {
+            std::size_t visited = 0;
+            world.with<Primary<B>, Secondary<B>>().each([&](Primary<B>& a, Secondary<B>& b) {
+                a.data[0] += b.data[0];
+                ++visited;
+            });
+            return visited;
+        }
+
+        // Archetype tables already are a per-mask cache.
+        template <std::size_t B>
+        static std::size_t query2(ArchetypeWorld& world) { return iterate2<B>(world); }
+
+        template <std::size_t B>
+        static std::size_t par_iterate2(ArchetypeWorld& world) {
+            world.with<Primary<B>, Secondary<B>>().par_each(
+                [](Primary<B>& a, Secondary<B>& b) { a.data[0] += b.data[0]; });
+            return world.size();
+        }
+    };
+
+    template <std::size_t B, typename Manager>
+    std::vector<Entity> populate(Manager& world, std::size_t count) {
+        std::vector<Entity> entities;
+        entities.reserve(count);
+        for(std::size_t i = 0; i < count; ++i) {
+            auto e = world.create();
+            world.template add_component<Primary<B>>(e);
+            world.template add_component<Secondary<B>>(e);
+            entities.push_back(e);
+        }
+        return entities;
+    }
+
+    class Suite {
+    public:
+        Suite(const Options& options) : options_(options) {}
+
+        template <typename Backend, std::size_t B>
+        void run(std::size_t count) {
+            using Manager = typename Backend::Manager;
+            std::unique_ptr<Manager> world;
+            std::vector<Entity> entities;
+            auto fresh = [&] {
+                world = std::make_unique<Manager>();
+                entities.clear();
+            };
+            auto populated = [&] {
+                fresh();
+                entities = populate<B>(*world, count);
+            };
+
+            measure<Backend, B>("create", count, fresh, [&] {
+                entities = populate<B>(*world, count);
+                return count;
+            });
+
+            if constexpr(std::is_same_v<Manager, World>) {
+                auto prefab = make_prefab(Primary<B>(), Secondary<B>());
+                measure<Backend, B>("create_n", count, fresh, [&] {
+                    entities = world->create_n(Index(count), prefab);
+                    return count;
+                });
+            }
+
+            measure<Backend, B>("destroy", count, populated, [&] {
+                for(auto e: entities) world->destroy(e);
+                return count;
+            });
+
+            // Destroys and recreates a random tenth of the entities, ten times over.
+            auto order = shuffled(count);
+            measure<Backend, B>("churn", count, populated, [&] {
+                std::size_t ops = 0;
+                for(std::size_t round = 0; round < 10; ++round) {
+                    for(std::size_t i = round; i < count; i += 10) {
+                        auto& e = entities[order[i]];
+                        world->destroy(e);
+                        e = world->create();
+                        world->template add_component<Primary<B>>(e);
+                        world->template add_component<Secondary<B>>(e);
+                        ops += 1;
+                    }
+                }
+                return ops;
+            });
+
+            measure<Backend, B>("add_remove", count, populated, [&] {
+                for(auto e: entities) world->template add_component<Extra<B>>(e);
+                for(auto e: entities) world->template remove_component<Extra<B>>(e);
+                return 2 * count;
+            });
+
+            measure<Backend, B>("iterate1", count, populated, [&] {
+                return Backend::template iterate1<B>(*world);
+            });
+
+            measure<Backend, B>("iterate2", count, populated, [&] {
+                return Backend::template iterate2<B>(*world);
+            });
+
+            // Cached query, built outside the timed run.
+            auto queried = [&] {
+                populated();
+                Backend::template query2<B>(*world);
+            };
+            measure<Backend, B>("query2", count, queried, [&] {
+                return Backend::template query2<B>(*world);
+            });
+
+            measure<Backend, B>("par_iterate2", count, populated, [&] {
+                return Backend::template par_iterate2<B>(*world);
+            });
+
+            measure<Backend, B>("random_get", count, populated, [&] {
+                float total = 0.f;
+                for(auto i: order) {
+                    total += world->template get_component<Primary<B>>(entities[i]).data[0];
+                }
+                sink = total;
+                return count;
+            });
+        }
+
+        // Add/remove churn on a component kept in a sparse-set pool, the chunked store's
+        // alternative for short-lived tags.
+        template <std::size_t B>
+        void run_sparse(std::size_t count) {
+            std::unique_ptr<World> world;
+            std::vector<Entity> entities;
+            auto populated = [&] {
+                world = std::make_unique<World>();
+                entities = populate<B>(*world, count);
+            };
+            measure_as<B>("add_remove", "sparse", count, populated, [&] {
+                for(auto e: entities) world->add_component<SparseExtra<B>>(e);
+                for(auto e: entities) world->remove_component<SparseExtra<B>>(e);
+                return 2 * count;
+            });
+        }
+
+        // "Gliders not circling": entities with Primary but without the Circling tag, which a
+        // third of them have. Counts matches without touching component memory.
+        template <std::size_t B>
+        void run_filters(std::size_t count) {
+            World world;
+            auto entities = populate<B>(world, count);
+            for(std::size_t i = 0; i < count; i += 3) world.add_component<Circling>(entities[i]);
+            auto none = [] {};
+
+            check_scan(world, {
+                {type_mask_v<Primary<B>, Circling>, TypeMask()},
+                {type_mask_v<Primary<B>>, type_mask_v<Circling>},
+                {type_mask_v<Circling>, type_mask_v<Secondary<B>>},
+            });
+
+            std::vector<MatchWord> bits(match_words(Index(count)));
+            for(auto isa: {ScanIsa::scalar, ScanIsa::sse2, ScanIsa::avx2}) {
+                if(isa > scan_isa()) continue;
+                measure_as<B>("mask_scan", scan_isa_name(isa), count, none, [&] {
+                    world.scan(type_mask_v<Primary<B>>, type_mask_v<Circling>, world.size(),
+                               bits.data(), isa);
+                    sink = float(bits[0]);
+                    return count;
+                });
+            }
+
+            measure_as<B>("filter", "has_component", count, none, [&] {
+                std::size_t found = 0;
+                for(auto e: entities) {
+                    found += world.has_component<Primary<B>>(e)
+                        && !world.has_component<Circling>(e);
+                }
+                sink = float(found);
+                return count;
+            });
+
+            measure_as<B>("filter", "without", count, none, [&] {
+                std::size_t found = 0;
+                for(auto item: world.with<const Primary<B>>().template without<Circling>()) {
+                    (void)item;
+                    found += 1;
+                }
+                sink = float(found);
+                return count;
+            });
+        }
+
+        // Position integration over particles that carry a payload, with the particle stored as
+        // one struct, as SoA arrays read through proxies, and as SoA arrays read directly, either
+        // per entity or a chunk at a time.
+        template <std::size_t B>
+        void run_layouts(std::size_t count) {
+            std::unique_ptr<World> world;
+            auto populated = [&] {
+                world = std::make_unique<World>();
+                for(std::size_t i = 0; i < count; ++i) {
+                    auto e = world->create();
+                    world->add_component<Particle<B>>(e, Particle<B>{{0, 0, 0}, {1, 2, 3}, {}});
+                    SoAParticle<B> soa;
+                    soa.position = {0, 0, 0};
+                    soa.velocity = {1, 2, 3};
+                    soa.payload = {};
+                    world->add_component<SoAParticle<B>>(e, soa);
+                }
+            };
+
+            measure_as<B>("integrate", "aos", count, populated, [&] {
+                for(auto [p]: world->with<Particle<B>>()) {
+                    p.position.x += p.velocity.x * 0.01f;
+                    p.position.y += p.velocity.y * 0.01f;
+                    p.position.z += p.velocity.z * 0.01f;
+                }
+                return count;
+            });
+
+            measure_as<B>("integrate", "aos_chunks", count, populated, [&] {
+                for(auto [n, p]: world->with<Particle<B>>().chunks()) {
+                    for(Index i = 0; i < n; ++i) {
+                        p[i].position.x += p[i].velocity.x * 0.01f;
+                        p[i].position.y += p[i].velocity.y * 0.01f;
+                        p[i].position.z += p[i].velocity.z * 0.01f;
+                    }
+                }
+                return count;
+            });
+
+            measure_as<B>("integrate", "soa", count, populated, [&] {
+                for(auto [p]: world->with<SoAParticle<B>>()) {
+                    p.position.x += p.velocity.x * 0.01f;
+                    p.position.y += p.velocity.y * 0.01f;
+                    p.position.z += p.velocity.z * 0.01f;
+                }
+                return count;
+            });
+
+            measure_as<B>("integrate", "soa_array", count, populated, [&] {
+                auto& store = world->storage<SoAParticle<B>>();
+                for(std::size_t base = 0; base < count; base += ENTITIES_PER_CHUNK) {
+                    auto chunk = Index(base / ENTITIES_PER_CHUNK);
+                    auto n = std::min<std::size_t>(ENTITIES_PER_CHUNK, count - base);
+                    Vec3f* position = store.template field<0>(chunk);
+                    const Vec3f* velocity = store.template field<1>(chunk);
+                    for(std::size_t i = 0; i < n; ++i) {
+                        position[i].x += velocity[i].x * 0.01f;
+                        position[i].y += velocity[i].y * 0.01f;
+                        position[i].z += velocity[i].z * 0.01f;
+                    }
+                }
+                return count;
+            });
+
+            measure_as<B>("integrate", "soa_chunks", count, populated, [&] {
+                for(auto [n, p]: world->with<SoAParticle<B>>().chunks()) {
+                    Vec3f* position = p.template field<0>();
+                    const Vec3f* velocity = p.template field<1>();
+                    for(Index i = 0; i < n; ++i) {
+                        position[i].x += velocity[i].x * 0.01f;
+                        position[i].y += velocity[i].y * 0.01f;
+                        position[i].z += velocity[i].z * 0.01f;
+                    }
+                }
+                return count;
+            });
+        }
+
+        // Radius queries against a brute-force scan, a hash grid and a loose octree. Entities are
+        // spread at constant density (about one per 10x10x10 cube), and each query looks for the
+        // neighbours within 15 units.
+        void run_spatial(std::size_t count) {
+            constexpr std::size_t bytes = sizeof(Located);
+            constexpr std::size_t queries = 1000;
+            constexpr float radius = 15.f;
+            const float extent = 5.f * std::cbrt(float(count));
+
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<float> coord(-extent, extent);
+            World world;
+            std::vector<Entity> entities;
+            for(std::size_t i = 0; i < count; ++i) {
+                auto e = world.create();
+                world.add_component<Located>(e, Located{{coord(rng), coord(rng), coord(rng)}, 1.f});
+                entities.push_back(e);
+            }
+            std::vector<Point> centers(queries);
+            for(auto& c: centers) c = {coord(rng), coord(rng), coord(rng)};
+
+            SpatialIndex<Located> grid(2.f * radius);
+            // Stop subdividing once leaves are about as large as the query, like the grid cells.
+            int depth = std::max(1, int(std::ceil(std::log2(extent / radius))));
+            SpatialIndex<Located, LooseOctree> octree(Point{0, 0, 0}, extent, depth);
+            grid.update(world);
+            octree.update(world);
+            auto none = [] {};
+
+            measure_as<bytes>("spatial_query", "brute", count, none, [&] {
+                std::size_t found = 0;
+                for(const auto& c: centers) {
+                    for(auto [l]: world.with<const Located>()) {
+                        float dx = l.center.x - c.x, dy = l.center.y - c.y, dz = l.center.z - c.z;
+                        float reach = radius + l.radius;
+                        if(dx * dx + dy * dy + dz * dz <= reach * reach) found += 1;
+                    }
+                }
+                sink = float(found);
+                return queries;
+            });
+
+            auto single = [&](const auto& index) {
+                std::size_t found = 0;
+                for(const auto& c: centers) index.query(c, radius, [&](Entity) { found += 1; });
+                sink = float(found);
+                return queries;
+            };
+            measure_as<bytes>("spatial_query", "grid", count, none, [&] { return single(grid); });
+            measure_as<bytes>("spatial_query", "octree", count, none, [&] {
+                return single(octree);
+            });
+
+            // One query per entity, batched on the thread pool.
+            std::vector<Point> everyone(count);
+            for(std::size_t i = 0; i < count; ++i) {
+                everyone[i] = world.read<const Located>(entities[i]).center;
+            }
+            std::vector<std::vector<Entity>> results(count);
+            auto batch = [&](const auto& index) {
+                index.query(everyone.data(), count, radius, results.data());
+                return count;
+            };
+            measure_as<bytes>("spatial_batch", "grid", count, none, [&] { return batch(grid); });
+            measure_as<bytes>("spatial_batch", "octree", count, none, [&] {
+                return batch(octree);
+            });
+
+            // Moves a tenth of the entities, then brings the index up to date.
+            auto move = [&] {
+                world.advance();
+                for(std::size_t i = 0; i < count; i += 10) {
+                    world.get_component<Located>(entities[i]).center.x += 3.f;
+                }
+            };
+            measure_as<bytes>("spatial_update", "grid", count, move, [&] {
+                grid.update(world);
+                return count / 10;
+            });
+            measure_as<bytes>("spatial_update", "octree", count, move, [&] {
+                octree.update(world);
+                return count / 10;
+            });
+        }
+
+        // fBm textures like the raymarcher's: a 2D coverage map (8 octaves) and a 3D density
+        // volume (5 octaves), both 10 units across. One op is one texel.
+        void run_noise(std::size_t side2, std::size_t side3) {
+            auto grid = [](std::size_t side, std::size_t dims, std::vector<float>* axes) {
+                const float h = 10.f / float(side);
+                std::size_t total = 1;
+                for(std::size_t d = 0; d < dims; ++d) total *= side;
+                for(std::size_t d = 0; d < dims; ++d) axes[d].resize(total);
+                for(std::size_t n = 0; n < total; ++n) {
+                    auto rest = n;
+                    for(std::size_t d = 0; d < dims; ++d, rest /= side) {
+                        axes[d][n] = float(rest % side) * h;
+                    }
+                }
+                return total;
+            };
+
+            std::vector<float> axes[3];
+            std::vector<float> reference, out;
+            const SimplexNoise coverage(0.1f), density(1.f);
+
+            auto count = grid(side2, 2, axes);
+            reference.resize(count);
+            out.resize(count);
+            coverage.fractal(8, axes[0].data(), axes[1].data(), reference.data(), count,
+                             SimplexNoise::Isa::scalar);
+            for_isas("simplex2d", count, reference, out, [&](SimplexNoise::Isa isa) {
+                coverage.fractal(8, axes[0].data(), axes[1].data(), out.data(), count, isa);
+                return count;
+            });
+
+            count = grid(side3, 3, axes);
+            reference.resize(count);
+            out.resize(count);
+            density.fractal(5, axes[0].data(), axes[1].data(), axes[2].data(), reference.data(),
+                            count, SimplexNoise::Isa::scalar);
+            for_isas("simplex3d", count, reference, out, [&](SimplexNoise::Isa isa) {
+                density.fractal(5, axes[0].data(), axes[1].data(), axes[2].data(), out.data(),
+                                count, isa);
+                return count;
+            });
+        }
+
+        bool failed() const { return failed_; }
+
+        void print() const;
+
+    private:
+        // Scans [world] for each (include, exclude) pair on every instruction set the CPU has,
+        // over entity counts that end mid-word as well as on a word boundary, and fails the run
+        // on any bit that differs from the scalar scan.
+        void check_scan(const World& world,
+                        std::initializer_list<std::pair<TypeMask, TypeMask>> filters) {
+            if(!options_.filter.empty() && options_.filter != "mask_scan") return;
+            const Index size = world.size();
+            for(Index count: {size, size - 1, size - 37, Index(640), Index(100), Index(63),
+                              Index(1)}) {
+                if(count > size) continue;
+                const auto words = match_words(count);
+                std::vector<MatchWord> reference(words), bits(words);
+                for(const auto& [include, exclude]: filters) {
+                    world.scan(include, exclude, count, reference.data(), ScanIsa::scalar);
+                    for(auto isa: {ScanIsa::sse2, ScanIsa::avx2}) {
+                        if(isa > scan_isa()) continue;
+                        std::fill(bits.begin(), bits.end(), ~MatchWord(0));
+                        world.scan(include, exclude, count, bits.data(), isa);
+                        if(bits == reference) continue;
+                        std::fprintf(stderr, "mask_scan/%s: bits differ from scalar over %u "
+                            "entities\n", scan_isa_name(isa), unsigned(count));
+                        failed_ = true;
+                    }
+                }
+            }
+        }
+
+        template <typename F>
+        void for_isas(const char* name, std::size_t count, const std::vector<float>& reference,
+                      std::vector<float>& out, const F& body) {
+            if(!options_.filter.empty() && options_.filter != name) return;
+            using Isa = SimplexNoise::Isa;
+            for(auto isa: {Isa::scalar, Isa::sse41, Isa::avx2, Isa::avx512}) {
+                if(isa > SimplexNoise::best_isa()) continue;
+                body(isa);
+                std::size_t wrong = 0;
+                for(std::size_t n = 0; n < count; ++n) wrong += out[n] != reference[n];
+                if(wrong) {
+                    std::fprintf(stderr, "%s/%s: %zu of %zu values differ from scalar\n",
+                        name, SimplexNoise::isa_name(isa), wrong, count);
+                    failed_ = true;
+                }
+                measure_as<sizeof(float)>(name, SimplexNoise::isa_name(isa), count, [] {},
+                                          [&] { return body(isa); });
+            }
+        }
+
+        template <typename Backend, std::size_t B>
+        void measure(const char* name, std::size_t count,
+                     const std::function<void()>& setup,
+                     const std::function<std::size_t()>& body) {
+            measure_as<B>(name, Backend::name, count, setup, body);
+        }
+
+        template <std::size_t B>
+        void measure_as(const char* name, const char* backend, std::size_t count,
+                        const std::function<void()>& setup,
+                        const std::function<std::size_t()>& body) {
+            if(!options_.filter.empty() && options_.filter != name) return;
+            std::size_t ops = 0;
+            auto ns = best_of(options_.reps, ops, setup, body);
+            results_.push_back(Result{name, backend, count, B, ns, ops});
+            std::fprintf(stderr, "%-14s %-10s %9zu x %3zuB: %10.2f ns/op\n",
+                name, backend, count, B, ns);
+        }
+
+        Options options_;
+        std::vector<Result> results_;
+        bool failed_ = false;
+    };
+
+    void Suite::print() const {
+        switch(options_.format) {
+        case Options::csv:
+            std::printf("case,backend,entities,component_bytes,ns_per_op,ops\n");
+            for(const auto& r: results_) {
+                std::printf("%s,%s,%zu,%zu,%.3f,%zu\n",
+                    r.name, r.backend, r.entities, r.bytes, r.ns_per_op, r.ops);
+            }
+            break;
+
+        case Options::json:
+            std::printf("[\n");
+            for(std::size_t i = 0; i < results_.size(); ++i) {
+                const auto& r = results_[i];
+                std::printf("  {\"case\": \"%s\", \"backend\": \"%s\", \"entities\": %zu, "
+                    "\"component_bytes\": %zu, \"ns_per_op\": %.3f, \"ops\": %zu}%s\n",
+                    r.name, r.backend, r.entities, r.bytes, r.ns_per_op, r.ops,
+                    i + 1 < results_.size() ? "," : "");
+            }
+            std::printf("]\n");
+            break;
+
+        case Options::table:
+            std::printf("%-14s %-10s %10s %6s %12s\n", "case", "backend", "entities", "bytes",
+                "ns/op");
+            for(const auto& r: results_) {
+                std::printf("%-14s %-10s %10zu %6zu %12.2f\n",
+                    r.name, r.backend, r.entities, r.bytes, r.ns_per_op);
+            }
+            break;
+        }
+    }
+
+    template <std::size_t B>
+    void sweep(Suite& suite, const std::vector<std::size_t>& counts) {
+        // Keep the largest runs under ~256MB per component array.
+        constexpr std::size_t max_bytes = 256 << 20;
+        for(auto count: counts) {
+            if(count * B > max_bytes) continue;
+            suite.run<ChunkedBackend, B>(count);
+            suite.run<ArchetypeBackend, B>(count);
+            suite.run_sparse<B>(count);
+            suite.run_filters<B>(count);
+            suite.run_layouts<B>(count);
+        }
+    }
+
+    bool parse(int argc, const char** argv, Options& options) {
+        for(int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if(arg == "--format=csv") options.format = Options::csv;
+            else if(arg == "--format=json") options.format = Options::json;
+            else if(arg == "--format=table") options.format = Options::table;
+            else if(arg == "--quick") options.quick = true;
+            else if(arg.rfind("--reps=", 0) == 0) options.reps = std::stoi(arg.substr(7));
+            else if(arg.rfind("--filter=", 0) == 0) options.filter = arg.substr(9);
+            else return false;
+        }
+        return options.reps > 0;
+    }
+}
+
+int main(int argc, const char** argv) {
+    Options options;
+    if(!parse(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--format=csv|json|table] [--quick] [--reps=N] "
+            "[--filter=case]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::size_t> counts = {1000, 10000, 100000, 1000000};
+    if(options.quick) counts = {1000, 10000, 100000};
+
+    Suite suite(options);
+    sweep<4>(suite, counts);
+    sweep<16>(suite, counts);
+    sweep<64>(suite, counts);
+    sweep<256>(suite, counts);
+    for(auto count: {std::size_t(10000), std::size_t(30000), std::size_t(100000)}) {
+        suite.run_spatial(count);
+    }
+    if(options.quick) {
+        suite.run_noise(256, 32);
+    } else {
+        suite.run_noise(1024, 128);
+    }
+    suite.print();
+    return suite.failed() ? 1 : 0;
+}
@@ -0,0 +1,308 @@
+//===--------------------------------------------------------------------------------------------===
+// archetype.hpp - Archetype (mask-grouped) component storage
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <ecs/entity.hpp>
+#include <ecs/meta.hpp>
+#include <ecs/thread_pool.hpp>
+
+namespace amyinorbit::ecs {
+
+    // Type-erased operations needed to move components between archetype tables.
+    struct ComponentInfo {
+        Index id;
+        std::size_t size;
+        std::size_t align;
+        void (*relocate)(void* dst, void* src); // move-construct dst from src, then destroy src
+        void (*destroy)(void* ptr);
+    };
+
+    template <typename T>
+    const ComponentInfo& component_info() {
+        static const ComponentInfo info {
+            component_id<T>(),
+            sizeof(T),
+            alignof(T),
+            [](void* dst, void* src) {
+                new (dst) T(std::move(*static_cast<T*>(src)));
+                static_cast<T*>(src)->~T();
+            },
+            [](void* ptr) { static_cast<T*>(ptr)->~T(); }
+        };
+        return info;
+    }
+
+    // A packed, growable array of one component type. Rows are kept contiguous: removing a row
+    // relocates the last one into the hole.
+    class Column {
+    public:
+        Column(const ComponentInfo& info) : info_(&info) {}
+        Column(Column&& other);
+        Column& operator=(Column&& other);
+        Column(const Column&) = delete;
+        Column& operator=(const Column&) = delete;
+        ~Column();
+
+        const ComponentInfo& info() const { return *info_; }
+        Index size() const { return size_; }
+
+        void* at(Index row) { return data_ + row * info_->size; }
+        const void* at(Index row) const { return data_ + row * info_->size; }
+
+        template <typename T> T* data() { return reinterpret_cast<T*>(data_); }
+        template <typename T> const T* data() const { return reinterpret_cast<const T*>(data_); }
+
+        // Returns uninitialised storage for a new row at the end of the column.
+        void* push();
+        // Fills the (already destroyed) slot at [row] with the last element.
+        void fill_hole(Index row);
+        void clear();
+
+    private:
+        void grow();
+
+        const ComponentInfo* info_;
+        std::uint8_t* data_ = nullptr;
+        Index size_ = 0;
+        Index capacity_ = 0;
+    };
+
+    // All entities that have exactly the same component mask, stored as one column per component.
+    struct Archetype {
+        Archetype(TypeMask mask, const ComponentInfo* const* infos);
+
+        Index size() const { return Index(entities.size()); }
+        bool has(Index id) const { return column_index[id] >= 0; }
+
+        Column& column(Index id) { return columns[column_index[id]]; }
+        const Column& column(Index id) const { return columns[column_index[id]]; }
+
+        template <typename T> T* data() { return column(component_id<T>()).template data<T>(); }
+
+        TypeMask mask;
+        std::vector<Entity> entities;
+        std::vector<Column> columns;
+        std::int16_t column_index[MAX_COMPONENTS];
+    };
+
+    template <typename... Cs>
+    class ArchetypeIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::tuple<Cs&...>;
+        using reference = std::tuple<Cs&...>;
+
+        ArchetypeIterator() {}
+        ArchetypeIterator(Archetype* const* current, Archetype* const* end)
+            : current_(current), end_(end) { load(); }
+
+        bool operator==(const ArchetypeIterator& other) const {
+            return current_ == other.current_ && row_ == other.row_;
+        }
+        bool operator!=(const ArchetypeIterator& other) const { return !(*this == other); }
+
+        ArchetypeIterator& operator++() {
+            if(++row_ == count_) {
+                ++current_;
+                load();
+            }
+            return *this;
+        }
+
+        reference operator*() const {
+            return std::apply([this](Cs*... cols) { return reference(cols[row_]...); }, columns_);
+        }
+
+    private:
+        void load() {
+            row_ = 0;
+            while(current_ != end_ && (*current_)->size() == 0) ++current_;
+            if(current_ == end_) return;
+            count_ = (*current_)->size();
+            columns_ = std::tuple<Cs*...>((*current_)->template data<Cs>()...);
+        }
+
+        Archetype* const* current_ = nullptr;
+        Archetype* const* end_ = nullptr;
+        Index row_ = 0;
+        Index count_ = 0;
+        std::tuple<Cs*...> columns_;
+    };
+
+    // Query result over an ArchetypeWorld: only the archetypes whose mask is a superset of the
+    // query are visited, and each one is walked as a set of packed arrays.
+    template <typename... Cs>
+    class ArchetypeView {
+    public:
+        using iterator = ArchetypeIterator<Cs...>;
+
+        ArchetypeView(std::vector<Archetype*> matches) : matches_(std::move(matches)) {}
+
+        iterator begin() const {
+            return iterator(matches_.data(), matches_.data() + matches_.size());
+        }
+        iterator end() const {
+            auto last = matches_.data() + matches_.size();
+            return iterator(last, last);
+        }
+
+        // Calls fn(Cs&...) on every match with plain indexed loops over each table.
+        template <typename F>
+        void each(F&& fn) const {
+            for(auto arch: matches_) {
+                each_in(*arch, fn, arch->template data<Cs>()...);
+            }
+        }
+
+        // Like each(), but every archetype table is split into ranges that run on a thread pool.
+        template <typename F>
+        void par_each(F&& fn, ThreadPool& pool = ThreadPool::shared()) const {
+            for(auto arch: matches_) {
+                auto cols = std::make_tuple(arch->template data<Cs>()...);
+                pool.parallel_for(0, arch->size(), ENTITIES_PER_CHUNK, [&](Index from, Index to) {
+                    for(Index row = from; row < to; ++row) {
+                        std::apply([&](Cs*... ptrs) { fn(ptrs[row]...); }, cols);
+                    }
+                });
+            }
+        }
+
+        std::size_t size() const {
+            std::size_t count = 0;
+            for(auto arch: matches_) count += arch->size();
+            return count;
+        }
+
+    private:
+        template <typename F>
+        static void each_in(const Archetype& arch, F& fn, Cs*... cols) {
+            const Index count = arch.size();
+            for(Index row = 0; row < count; ++row) {
+                fn(cols[row]...);
+            }
+        }
+
+        std::vector<Archetype*> matches_;
+    };
+
+    // Entity manager that groups entities sharing a TypeMask in contiguous per-component arrays.
+    // Component references are only valid until the next structural change (create, destroy,
+    // add_component, remove_component), since those may relocate rows.
+    class ArchetypeWorld {
+    public:
+        ArchetypeWorld();
+        ~ArchetypeWorld();
+        ArchetypeWorld(const ArchetypeWorld&) = delete;
+        ArchetypeWorld& operator=(const ArchetypeWorld&) = delete;
+
+        Entity create();
+        void destroy(Entity entity);
+
+        Entity entity(Index idx) const { return Entity{idx, versions_[idx]}; }
+        Index size() const { return Index(records_.size()); }
+        std::size_t archetype_count() const { return archetypes_.size(); }
+
+        template <typename T, typename... Args>
+        T& add_component(Entity entity, Args&&... args) {
+            assert(is_valid(entity));
+            assert(!has_component<T>(entity));
+            const auto& info = register_component<T>();
+            auto target = find_or_create(records_[entity.id].mask | type_mask_v<T>);
+            move_entity(entity, target);
+            void* slot = archetypes_[target]->column(info.id).push();
+            if constexpr(std::is_constructible_v<T, Args...>) {
+                return *(new (slot) T(std::forward<Args>(args)...));
+            } else {
+                return *(new (slot) T{std::forward<Args>(args)...});
+            }
+        }
+
+        template <typename T>
+        void remove_component(Entity entity) {
+            assert(is_valid(entity));
+            assert(has_component<T>(entity));
+            auto target = find_or_create(records_[entity.id].mask & ~type_mask_v<T>);
+            move_entity(entity, target);
+        }
+
+        template <typename T>
+        T& get_component(Entity entity) {
+            assert(is_valid(entity));
+            assert(has_component<T>(entity));
+            const auto& rec = records_[entity.id];
+            return archetypes_[rec.archetype]->data<T>()[rec.row];
+        }
+
+        template <typename T>
+        const T& get_component(Entity entity) const {
+            assert(is_valid(entity));
+            assert(has_component<T>(entity));
+            const auto& rec = records_[entity.id];
+            return archetypes_[rec.archetype]->data<T>()[rec.row];
+        }
+
+        template <typename T>
+        bool has_component(Entity entity) const {
+            return records_[entity.id].mask.test(component_id<T>());
+        }
+
+        template <typename... Ts>
+        bool has_components(Entity entity) const {
+            return records_[entity.id].mask.contains(type_mask_v<Ts...>);
+        }
+
+        bool is_valid(Entity entity) const {
+            return versions_[entity.id] == entity.version;
+        }
+
+        template <typename... Ts>
+        ArchetypeView<Ts...> with() {
+            std::vector<Archetype*> matches;
+            for(const auto& arch: archetypes_) {
+                if(arch->mask.contains(type_mask_v<Ts...>)) matches.push_back(arch.get());
+            }
+            return ArchetypeView<Ts...>(std::move(matches));
+        }
+
+    private:
+        struct Record {
+            TypeMask mask;
+            Index archetype;
+            Index row;
+        };
+
+        template <typename T>
+        const ComponentInfo& register_component() {
+            const auto& info = component_info<T>();
+            assert(!infos_[info.id] || infos_[info.id] == &info);
+            infos_[info.id] = &info;
+            return info;
+        }
+
+        Index find_or_create(TypeMask mask);
+        Index move_entity(Entity entity, Index target);
+        void remove_row(Archetype& arch, Index row);
+
+        std::vector<std::unique_ptr<Archetype>> archetypes_;
+        std::unordered_map<TypeMask, Index> lookup_;
+        const ComponentInfo* infos_[MAX_COMPONENTS] = {};
+
+        std::vector<Record> records_;
+        std::vector<Index> versions_;
+        std::vector<Index> free_list_;
+    };
+}
@@ -0,0 +1,163 @@
+//===--------------------------------------------------------------------------------------------===
+// buffered.hpp - Triple-buffered component state shared between threads
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include <ecs/world.hpp>
+
+namespace amyinorbit::ecs {
+
+    // Lock-free triple buffer: one thread writes into back(), then publish() makes it the latest
+    // value; another thread calls acquire() to switch to the latest published value, and reads
+    // front() until its next acquire(). Neither side ever waits for the other, and each owns its
+    // buffer outright between sync points, so the buffers need no locking of their own.
+    template <typename T>
+    class TripleBuffer {
+    public:
+        T& back() { return buffers_[back_]; }
+        const T& front() const { return buffers_[front_]; }
+
+        // Writer side: hands back() over to the reader and takes the oldest buffer as the new
+        // back(). Its contents are whatever that buffer held before.
+        void publish() {
+            auto previous = ready_.exchange(std::uint8_t(back_ | fresh), std::memory_order_acq_rel);
+            back_ = previous & index_mask;
+        }
+
+        // Reader side: switches front() to the latest published buffer, if there is a new one.
+        // Returns whether front() changed.
+        bool acquire() {
+            if(!(ready_.load(std::memory_order_relaxed) & fresh)) return false;
+            auto previous = ready_.exchange(front_, std::memory_order_acq_rel);
+            front_ = previous & index_mask;
+            return true;
+        }
+
+    private:
+        static constexpr std::uint8_t fresh = 0x4;
+        static constexpr std::uint8_t index_mask = 0x3;
+
+        T buffers_[3];
+        std::uint8_t back_ = 0;
+        std::uint8_t front_ = 1;
+        std::atomic<std::uint8_t> ready_{2};
+    };
+
+    // Copies of the components Ts of every entity that has them, as they were at one tick.
+    // Each component type is captured separately, so an entity shows up in the list of each
+    // component it has.
+    template <typename... Ts>
+    class Frame {
+    public:
+        static constexpr Index npos = ~Index(0);
+
+        template <typename T>
+        struct Track {
+            std::vector<Entity> entities;
+            std::vector<T> values;
+            std::vector<Index> slots; // entity id -> index into values, or npos
+        };
+
+        Tick tick() const { return tick_; }
+        std::uint64_t sequence() const { return sequence_; }
+
+        template <typename T>
+        Index size() const { return Index(track<T>().values.size()); }
+
+        // Calls fn(Entity, const T&) for every captured T.
+        template <typename T, typename F>
+        void each(F&& fn) const {
+            const auto& t = track<T>();
+            for(std::size_t i = 0; i < t.values.size(); ++i) fn(t.entities[i], t.values[i]);
+        }
+
+        // The captured T of [entity], or nullptr if it had none.
+        template <typename T>
+        const T* find(Entity entity) const {
+            const auto& t = track<T>();
+            if(entity.id >= t.slots.size()) return nullptr;
+            auto slot = t.slots[entity.id];
+            if(slot == npos || t.entities[slot].version != entity.version) return nullptr;
+            return &t.values[slot];
+        }
+
+        // Replaces the contents with the current state of [world]. Storage is reused from one
+        // capture to the next, so steady-state captures do not allocate.
+        void capture(World& world, std::uint64_t sequence) {
+            tick_ = world.tick();
+            sequence_ = sequence;
+            (capture_track<Ts>(world), ...);
+        }
+
+    private:
+        template <typename T>
+        Track<T>& track() { return std::get<Track<T>>(tracks_); }
+        template <typename T>
+        const Track<T>& track() const { return std::get<Track<T>>(tracks_); }
+
+        template <typename T>
+        void capture_track(World& world) {
+            auto& t = track<T>();
+            for(auto e: t.entities) t.slots[e.id] = npos;
+            t.entities.clear();
+            t.values.clear();
+            t.slots.resize(world.size(), npos);
+
+            for(const auto& item: world.query<const T>()) {
+                auto entity = item.entity();
+                t.slots[entity.id] = Index(t.values.size());
+                t.entities.push_back(entity);
+                t.values.emplace_back(item.template get<0>());
+            }
+        }
+
+        Tick tick_ = 0;
+        std::uint64_t sequence_ = 0;
+        std::tuple<Track<Ts>...> tracks_;
+    };
+
+    // Snapshots of a world for a reader on another thread, typically a renderer that draws frame
+    // N while the simulation steps towards N+1. The simulation thread calls publish() after each
+    // step, which copies Ts into a spare frame; the reader calls acquire() once per frame and
+    // reads the last complete frame from front(). publish() must not run concurrently with
+    // anything that writes the world, and the reader must not touch the world at all.
+    //
+    // Captured values are copied and destroyed on the writer's thread, so Ts must be plain data:
+    // anything that owns a resource tied to the reader's thread (a GL texture...) stays with the
+    // reader, and the component only names it.
+    template <typename... Ts>
+    class FrameState {
+        static_assert((std::is_trivially_copyable_v<Ts> && ...),
+                      "frame state components must be trivially copyable");
+    public:
+        using frame_type = Frame<Ts...>;
+
+        void publish(World& world) {
+            frame_.back().capture(world, ++published_);
+            frame_.publish();
+        }
+
+        const frame_type& acquire() {
+            frame_.acquire();
+            return frame_.front();
+        }
+
+        const frame_type& front() const { return frame_.front(); }
+
+        // Number of frames published so far. Writer thread only.
+        std::uint64_t published() const { return published_; }
+
+    private:
+        TripleBuffer<frame_type> frame_;
+        std::uint64_t published_ = 0;
+    };
+}
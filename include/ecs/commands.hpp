@@ -0,0 +1,103 @@
+//===--------------------------------------------------------------------------------------------===
+// commands.hpp - Deferred structural changes to a world
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <ecs/world.hpp>
+
+namespace amyinorbit::ecs {
+
+    // Records create/destroy/add/remove operations so they can be issued while iterating or from
+    // worker threads, and applied later in one batch by World::flush(). Each thread gets its own
+    // buffer from World::commands(), so recording never takes a lock.
+    class CommandBuffer {
+    public:
+        CommandBuffer(World& world) : world_(world) {}
+        ~CommandBuffer() { clear(); }
+        CommandBuffer(const CommandBuffer&) = delete;
+        CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+        // Returns a fresh entity id that becomes live at the next flush. Components can be added
+        // to it through the buffer straight away.
+        Entity create() { return world_.reserve(); }
+
+        void destroy(Entity entity) {
+            push(entity, nullptr, [](World& world, Entity e, void*) {
+                if(world.is_valid(e)) world.destroy(e);
+            }, nullptr);
+        }
+
+        template <typename T, typename... Args>
+        void add_component(Entity entity, Args&&... args) {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned command payload");
+            void* payload = allocate(sizeof(T));
+            if constexpr(std::is_constructible_v<T, Args...>) {
+                new (payload) T(std::forward<Args>(args)...);
+            } else {
+                new (payload) T{std::forward<Args>(args)...};
+            }
+            push(entity, payload, [](World& world, Entity e, void* p) {
+                if(!world.is_valid(e)) return;
+                auto& component = *static_cast<T*>(p);
+                if(world.has_component<T>(e)) {
+                    world.set_component<T>(e, std::move(component));
+                } else {
+                    world.add_component<T>(e, std::move(component));
+                }
+            }, [](void* p) { static_cast<T*>(p)->~T(); });
+        }
+
+        template <typename T>
+        void remove_component(Entity entity) {
+            push(entity, nullptr, [](World& world, Entity e, void*) {
+                if(world.is_valid(e) && world.has_component<T>(e)) world.remove_component<T>(e);
+            }, nullptr);
+        }
+
+        bool empty() const { return commands_.empty(); }
+        std::size_t size() const { return commands_.size(); }
+
+        // Applies every recorded command in order, then resets the buffer. Only call this from
+        // World::flush(), which makes sure reserved entities exist first.
+        void apply();
+        void clear();
+
+    private:
+        using Run = void (*)(World&, Entity, void*);
+        using Drop = void (*)(void*);
+
+        struct Command {
+            Entity entity;
+            void* payload;
+            Run run;
+            Drop drop;
+        };
+
+        static constexpr std::size_t block_size = 16 * 1024;
+
+        void push(Entity entity, void* payload, Run run, Drop drop) {
+            commands_.push_back(Command{entity, payload, run, drop});
+        }
+
+        // Payloads live in fixed blocks that are kept across frames, so they never move and the
+        // steady state does not allocate.
+        void* allocate(std::size_t size);
+
+        World& world_;
+        std::vector<Command> commands_;
+        std::vector<std::unique_ptr<byte[]>> blocks_;
+        std::vector<std::unique_ptr<byte[]>> oversized_;
+        std::size_t block_ = 0;
+        std::size_t used_ = 0;
+    };
+}
@@ -8,15 +8,17 @@
 //===--------------------------------------------------------------------------------------------===
 #pragma once
 #include <cstdint>
+#include <ecs/mask.hpp>
 
-#define MAX_ENTITIES 128
-#define MAX_COMPONENTS 16
+#define MAX_COMPONENTS 128
+#define ENTITIES_PER_CHUNK 1024
 
 namespace amyinorbit::ecs {
 
-    using Index = std::uint16_t;
+    using Index = std::uint32_t;
     using TypeID = std::uint8_t;
-    using TypeMask = std::uint16_t;
+    using TypeMask = BitMask<MAX_COMPONENTS>;
+    using Tick = std::uint32_t;
 
     struct Entity {
         Index id;
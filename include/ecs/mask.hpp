@@ -0,0 +1,130 @@
+//===--------------------------------------------------------------------------------------------===
+// mask.hpp - Fixed-width component bitset
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace amyinorbit::ecs {
+
+    // Bitset of [Bits] component flags, stored as whole 64-bit words. All operations are constexpr
+    // and branch-free over a fixed word count, so mask constants fold at compile time and the
+    // compiler can keep a mask in a single SIMD register.
+    template <std::size_t Bits>
+    class alignas(16) BitMask {
+    public:
+        using Word = std::uint64_t;
+        static constexpr std::size_t word_bits = 64;
+        static constexpr std::size_t words = (Bits + word_bits - 1) / word_bits;
+
+        constexpr BitMask() : words_{} {}
+
+        static constexpr BitMask bit(std::size_t index) {
+            BitMask mask;
+            mask.words_[index / word_bits] = Word(1) << (index % word_bits);
+            return mask;
+        }
+
+        constexpr bool test(std::size_t index) const {
+            return (words_[index / word_bits] >> (index % word_bits)) & 1;
+        }
+
+        constexpr BitMask& set(std::size_t index) {
+            words_[index / word_bits] |= Word(1) << (index % word_bits);
+            return *this;
+        }
+
+        constexpr BitMask& reset(std::size_t index) {
+            words_[index / word_bits] &= ~(Word(1) << (index % word_bits));
+            return *this;
+        }
+
+        constexpr bool any() const {
+            Word acc = 0;
+            for(std::size_t i = 0; i < words; ++i) acc |= words_[i];
+            return acc != 0;
+        }
+
+        constexpr bool none() const { return !any(); }
+        constexpr explicit operator bool() const { return any(); }
+
+        // Subset test: true if every bit of [other] is also set in this mask.
+        constexpr bool contains(const BitMask& other) const {
+            Word acc = 0;
+            for(std::size_t i = 0; i < words; ++i) {
+                acc |= (words_[i] & other.words_[i]) ^ other.words_[i];
+            }
+            return acc == 0;
+        }
+
+        constexpr bool intersects(const BitMask& other) const {
+            Word acc = 0;
+            for(std::size_t i = 0; i < words; ++i) acc |= words_[i] & other.words_[i];
+            return acc != 0;
+        }
+
+        constexpr BitMask& operator|=(const BitMask& other) {
+            for(std::size_t i = 0; i < words; ++i) words_[i] |= other.words_[i];
+            return *this;
+        }
+
+        constexpr BitMask& operator&=(const BitMask& other) {
+            for(std::size_t i = 0; i < words; ++i) words_[i] &= other.words_[i];
+            return *this;
+        }
+
+        constexpr BitMask operator~() const {
+            BitMask result;
+            for(std::size_t i = 0; i < words; ++i) result.words_[i] = ~words_[i];
+            return result;
+        }
+
+        friend constexpr BitMask operator|(BitMask lhs, const BitMask& rhs) { return lhs |= rhs; }
+        friend constexpr BitMask operator&(BitMask lhs, const BitMask& rhs) { return lhs &= rhs; }
+
+        friend constexpr bool operator==(const BitMask& lhs, const BitMask& rhs) {
+            Word acc = 0;
+            for(std::size_t i = 0; i < words; ++i) acc |= lhs.words_[i] ^ rhs.words_[i];
+            return acc == 0;
+        }
+        friend constexpr bool operator!=(const BitMask& lhs, const BitMask& rhs) {
+            return !(lhs == rhs);
+        }
+
+        // Calls fn(index) for every set bit, lowest first.
+        template <typename F>
+        void each(F&& fn) const {
+            for(std::size_t i = 0; i < words; ++i) {
+                for(Word w = words_[i]; w; w &= w - 1) {
+                    fn(i * word_bits + std::size_t(__builtin_ctzll(w)));
+                }
+            }
+        }
+
+        constexpr Word word(std::size_t index) const { return words_[index]; }
+
+        std::size_t hash() const {
+            std::size_t h = 0;
+            for(std::size_t i = 0; i < words; ++i) h = h * 31 + std::hash<Word>()(words_[i]);
+            return h;
+        }
+
+    private:
+        Word words_[words];
+    };
+}
+
+namespace std {
+    template <std::size_t Bits>
+    struct hash<amyinorbit::ecs::BitMask<Bits>> {
+        std::size_t operator()(const amyinorbit::ecs::BitMask<Bits>& mask) const {
+            return mask.hash();
+        }
+    };
+}
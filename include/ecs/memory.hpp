@@ -0,0 +1,113 @@
+//===--------------------------------------------------------------------------------------------===
+// memory.hpp - Arena and cache-aligned allocation for world storage
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#define CACHE_LINE_SIZE 64
+
+namespace amyinorbit::ecs {
+
+    struct ArenaOptions {
+        std::size_t block_size = std::size_t(2) << 20; // one 2MB huge page
+        bool huge_pages = false;
+    };
+
+    // Memory resource that carves allocations out of large blocks. Every allocation is at least
+    // cache-line aligned, and rounded up to a power-of-two size class. Freed memory goes on the
+    // free list of its class, and larger free buffers are split for smaller requests, so the
+    // buffers a growing vector leaves behind are reused for store chunks. Blocks are only
+    // returned to the system, all at once, when the arena is released or destroyed. With
+    // [huge_pages], blocks are requested as transparent huge pages where the OS supports it.
+    // Not thread-safe: a world only allocates during structural changes, which are serialised.
+    class ArenaResource : public std::pmr::memory_resource {
+    public:
+        explicit ArenaResource(const ArenaOptions& options = ArenaOptions());
+        ~ArenaResource();
+        ArenaResource(const ArenaResource&) = delete;
+        ArenaResource& operator=(const ArenaResource&) = delete;
+
+        // Returns every block to the system. Anything allocated from the arena is invalidated.
+        void release();
+
+        // Bytes obtained from the system, and bytes currently handed out.
+        std::size_t reserved() const { return reserved_; }
+        std::size_t used() const { return used_; }
+
+    private:
+        struct Block {
+            std::uint8_t* data;
+            std::size_t size;
+            bool mapped;
+        };
+
+        struct FreeNode {
+            FreeNode* next;
+        };
+
+        void* do_allocate(std::size_t bytes, std::size_t align) override;
+        void do_deallocate(void* ptr, std::size_t bytes, std::size_t align) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        Block allocate_block(std::size_t size);
+        void push_free(void* ptr, std::size_t size);
+
+        ArenaOptions options_;
+        std::vector<Block> blocks_;
+        std::uint8_t* cursor_ = nullptr;
+        std::uint8_t* end_ = nullptr;
+        std::unordered_map<std::size_t, FreeNode*> free_lists_; // by size class
+        std::size_t largest_free_ = 0; // largest size class ever freed
+        std::size_t reserved_ = 0;
+        std::size_t used_ = 0;
+    };
+
+    // Standard allocator over a memory resource that aligns every allocation to at least a cache
+    // line, so packed component arrays never share a line with unrelated data.
+    template <typename T>
+    class CacheAligned {
+    public:
+        using value_type = T;
+        static constexpr std::size_t alignment =
+            alignof(T) > CACHE_LINE_SIZE ? alignof(T) : CACHE_LINE_SIZE;
+
+        CacheAligned() noexcept : resource_(std::pmr::get_default_resource()) {}
+        CacheAligned(std::pmr::memory_resource* resource) noexcept : resource_(resource) {}
+        template <typename U>
+        CacheAligned(const CacheAligned<U>& other) noexcept : resource_(other.resource()) {}
+
+        T* allocate(std::size_t count) {
+            return static_cast<T*>(resource_->allocate(count * sizeof(T), alignment));
+        }
+
+        void deallocate(T* ptr, std::size_t count) {
+            resource_->deallocate(ptr, count * sizeof(T), alignment);
+        }
+
+        std::pmr::memory_resource* resource() const { return resource_; }
+
+        template <typename U>
+        bool operator==(const CacheAligned<U>& other) const {
+            return resource_ == other.resource();
+        }
+        template <typename U>
+        bool operator!=(const CacheAligned<U>& other) const { return !(*this == other); }
+
+    private:
+        std::pmr::memory_resource* resource_;
+    };
+
+    template <typename T>
+    using aligned_vector = std::vector<T, CacheAligned<T>>;
+}
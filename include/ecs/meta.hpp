@@ -14,27 +14,115 @@ namespace amyinorbit::ecs {
 
     template <typename... Ts> struct type_list {};
 
-    inline Index &component_counter() {
-      static Index counter = 0;
-      return counter;
-    }
+    // MARK: - Query terms
+    // Queries name components either as C (read-write access, marks the component as changed),
+    // const C (read-only access), or Changed<C> (only entities whose C changed since a tick).
+
+    template <typename C> struct Changed {};
+
+    template <typename Q>
+    struct query_traits {
+        using component = std::remove_const_t<Q>;
+        static constexpr bool read_only = std::is_const_v<Q>;
+        static constexpr bool changed = false;
+    };
+
+    template <typename Q>
+    struct query_traits<Changed<Q>> : query_traits<Q> {
+        static constexpr bool changed = true;
+    };
+
+    template <typename Q>
+    using component_t = typename query_traits<Q>::component;
+
+    // MARK: - Component layouts
+    // Components are stored as arrays of structs by default, and handed out as plain references.
+    // A component can instead declare a struct-of-arrays layout, where each field lives in its own
+    // contiguous array and accessors return a proxy that reads like the component itself:
+    //
+    //     template <> struct soa_layout<Transform> {
+    //         using fields = type_list<vec3, vec3, quaternion>; // one array per field
+    //         using reference = TransformRef;                   // built from (vec3*, vec3*, ...)
+    //         using const_reference = const TransformRef;
+    //     };
+    //
+    // The reference type is constructed from pointers to one row of every field, and must be
+    // assignable from the component type so components can be added and set by value.
 
-    template<typename C>
-    Index component_id() {
-      static Index index = component_counter()++;
-      return index;
-    }
+    template <typename C>
+    struct soa_layout {};
+
+    template <typename C, typename = void>
+    struct component_ref {
+        using type = C&;
+        using const_type = const C&;
+    };
+
+    template <typename C>
+    struct component_ref<C, std::void_t<typename soa_layout<C>::reference>> {
+        using type = typename soa_layout<C>::reference;
+        using const_type = typename soa_layout<C>::const_reference;
+    };
+
+    template <typename C>
+    using component_ref_t = typename component_ref<C>::type;
+
+    template <typename C>
+    using component_cref_t = typename component_ref<C>::const_type;
 
     template <typename C>
-    TypeMask type_mask() {
-        return 1 << component_id<C>();
+    constexpr bool is_soa_v = !std::is_reference_v<component_ref_t<C>>;
+
+    template <typename Q>
+    using query_ref_t = std::conditional_t<
+        query_traits<Q>::read_only,
+        component_cref_t<component_t<Q>>,
+        component_ref_t<component_t<Q>>
+    >;
+
+    // MARK: - Component registration
+    // Every component type gets a fixed id in [0, MAX_COMPONENTS) at compile time, so ids do not
+    // depend on call order and masks fold to constants:
+    //
+    //     ECS_COMPONENT(Transform, 0);
+    //
+    // The macro must be used at global scope, or in a namespace that encloses amyinorbit::ecs.
+
+    template <typename C>
+    struct component_traits {
+        static_assert(!sizeof(C*), "component type is not registered with ECS_COMPONENT");
+    };
+
+    #define ECS_COMPONENT(Type, Id)                                                             \
+        template <> struct amyinorbit::ecs::component_traits<Type> {                           \
+            static constexpr ::amyinorbit::ecs::Index id = Id;                                 \
+            static constexpr const char* name = #Type;                                         \
+        }
+
+    template <typename C>
+    constexpr Index component_id() {
+        constexpr Index id = component_traits<component_t<C>>::id;
+        static_assert(id < MAX_COMPONENTS, "component id out of range");
+        return id;
     }
 
-    template <typename C1, typename C2, typename... Cs>
-    TypeMask type_mask() {
-        return type_mask<C1>() | type_mask<C1, Cs...>();
+    // The type name as spelled in ECS_COMPONENT, for diagnostics.
+    template <typename C>
+    constexpr const char* component_name() { return component_traits<component_t<C>>::name; }
+
+    template <typename... Cs>
+    constexpr TypeMask type_mask() {
+        return (TypeMask() | ... | TypeMask::bit(component_id<Cs>()));
     }
 
+    // Unique address per component type, used to catch two types registered with the same id.
+    template <typename C>
+    inline constexpr char type_key = 0;
+
+    // Constant mask of a component list, for hot paths.
+    template <typename... Cs>
+    inline constexpr TypeMask type_mask_v = type_mask<Cs...>();
+
     // MARK: - Type list utilities
     // List inclusion check
 
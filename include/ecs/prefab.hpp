@@ -0,0 +1,44 @@
+//===--------------------------------------------------------------------------------------------===
+// prefab.hpp - Component templates for bulk entity creation
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <tuple>
+#include <utility>
+#include <ecs/meta.hpp>
+
+namespace amyinorbit::ecs {
+
+    // A set of component values that World::create_n() copies onto every entity it creates:
+    //
+    //     auto glider = make_prefab(Transform(), Glider{12.f});
+    //     auto fleet = world.create_n(1000, glider);
+    //
+    // The component mask is known at compile time, so instantiating a prefab writes masks and
+    // components in bulk instead of going through add_component() once per entity and type.
+    template <typename... Ts>
+    struct Prefab {
+        static_assert(sizeof...(Ts) > 0, "prefabs need at least one component");
+
+        Prefab() = default;
+        explicit Prefab(Ts... values) : components(std::move(values)...) {}
+
+        template <typename T>
+        T& get() { return std::get<T>(components); }
+        template <typename T>
+        const T& get() const { return std::get<T>(components); }
+
+        static constexpr TypeMask mask() { return type_mask_v<Ts...>; }
+
+        std::tuple<Ts...> components;
+    };
+
+    template <typename... Ts>
+    Prefab<std::decay_t<Ts>...> make_prefab(Ts&&... values) {
+        return Prefab<std::decay_t<Ts>...>(std::forward<Ts>(values)...);
+    }
+}
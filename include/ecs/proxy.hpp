@@ -21,20 +21,24 @@ namespace amyinorbit::ecs {
 
         Proxy(World* world, Entity entity) : world_(world), entity_(entity) {}
 
+        Entity entity() const { return entity_; }
+
         template <typename C>
-        auto get_component() -> std::enable_if_t<in_list_v<C, Cs...>, C&>;
+        auto get_component() -> std::enable_if_t<in_list_v<C, Cs...>, query_ref_t<C>>;
 
         template <typename C>
-        auto get_component() const -> std::enable_if_t<in_list_v<C, Cs...>, const C&>;
+        auto get_component() const
+            -> std::enable_if_t<in_list_v<C, Cs...>, component_cref_t<component_t<C>>>;
 
         template <typename C>
         auto has_component() const -> std::enable_if_t<in_list_v<C, Cs...>, bool>;
 
+        // Non-const access marks the component as changed unless the query asked for const C.
         template <std::size_t N>
-        nth_type_t<N, Cs...>& get() { return get_component<nth_type_t<N, Cs...>>(); }
+        query_ref_t<nth_type_t<N, Cs...>> get();
 
         template <std::size_t N>
-        const nth_type_t<N, Cs...>& get() const { return get_component<nth_type_t<N, Cs...>>(); }
+        component_cref_t<component_t<nth_type_t<N, Cs...>>> get() const;
 
     private:
         World* world_;
@@ -49,6 +53,7 @@ namespace std {
 
     template <std::size_t N, typename... Cs>
     struct tuple_element<N, amyinorbit::ecs::Proxy<Cs...>> {
-        using type = amyinorbit::ecs::nth_type_t<N, Cs...>;
+        using type = std::remove_reference_t<
+            amyinorbit::ecs::query_ref_t<amyinorbit::ecs::nth_type_t<N, Cs...>>>;
     };
 }
@@ -12,15 +12,29 @@ namespace amyinorbit::ecs {
 
     template <typename... Cs>
     template <typename C>
-    inline auto Proxy<Cs...>::get_component() -> std::enable_if_t<in_list_v<C, Cs...>, C&> {
-        return world_->get_component_unchk<C>(entity_);
+    inline auto Proxy<Cs...>::get_component()
+    -> std::enable_if_t<in_list_v<C, Cs...>, query_ref_t<C>> {
+        return world_->template access<C>(entity_);
     }
 
     template <typename... Cs>
     template <typename C>
     inline auto Proxy<Cs...>::get_component() const
-    -> std::enable_if_t<in_list_v<C, Cs...>, const C&> {
-        return world_->get_component_unchk<C>(entity_);
+    -> std::enable_if_t<in_list_v<C, Cs...>, component_cref_t<component_t<C>>> {
+        return world_->template read<C>(entity_);
+    }
+
+    template <typename... Cs>
+    template <std::size_t N>
+    inline auto Proxy<Cs...>::get() -> query_ref_t<nth_type_t<N, Cs...>> {
+        return world_->template access<nth_type_t<N, Cs...>>(entity_);
+    }
+
+    template <typename... Cs>
+    template <std::size_t N>
+    inline auto Proxy<Cs...>::get() const
+    -> component_cref_t<component_t<nth_type_t<N, Cs...>>> {
+        return world_->template read<nth_type_t<N, Cs...>>(entity_);
     }
 
     template <typename... Cs>
@@ -0,0 +1,74 @@
+//===--------------------------------------------------------------------------------------------===
+// query.hpp - Persistent, incrementally-updated entity queries
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <ecs/entity.hpp>
+
+namespace amyinorbit::ecs {
+
+    // The list of entities whose mask contains a given component mask. The world updates it
+    // whenever an entity's mask changes, so iterating it never scans non-matching entities.
+    // Removal swaps the last entity into the hole: the list is not kept in id order.
+    class Query {
+    public:
+        static constexpr Index npos = ~Index(0);
+
+        Query(const TypeMask& mask) : mask_(mask) {}
+
+        const TypeMask& mask() const { return mask_; }
+        const Index* data() const { return entities_.data(); }
+        Index size() const { return Index(entities_.size()); }
+
+        bool contains(Index id) const { return id < slots_.size() && slots_[id] != npos; }
+
+        // Called whenever entity [id]'s mask changes from [from] to [to].
+        void update(Index id, const TypeMask& from, const TypeMask& to) {
+            bool had = from.contains(mask_);
+            bool has = to.contains(mask_);
+            if(had == has) return;
+            if(has) {
+                insert(id);
+            } else {
+                erase(id);
+            }
+        }
+
+        void insert(Index id) {
+            if(id >= slots_.size()) slots_.resize(id + 1, npos);
+            slots_[id] = Index(entities_.size());
+            entities_.push_back(id);
+        }
+
+        void erase(Index id) {
+            auto slot = slots_[id];
+            auto last = entities_.back();
+            entities_[slot] = last;
+            slots_[last] = slot;
+            entities_.pop_back();
+            slots_[id] = npos;
+        }
+
+        void clear() {
+            entities_.clear();
+            slots_.clear();
+        }
+
+    private:
+        TypeMask mask_;
+        std::vector<Index> entities_;
+        std::vector<Index> slots_;
+    };
+
+    struct QueryStats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t queries = 0;
+    };
+}
@@ -0,0 +1,52 @@
+//===--------------------------------------------------------------------------------------------===
+// scan.hpp - Vectorised component mask scanning
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <ecs/entity.hpp>
+
+namespace amyinorbit::ecs {
+
+    using MatchWord = std::uint64_t;
+
+    // Number of 64-bit words needed for the match bits of [count] entities.
+    constexpr Index match_words(Index count) { return (count + 63) / 64; }
+
+    // First id in [from, end) whose bit is set, or [end].
+    inline Index next_match(const MatchWord* bits, Index from, Index end) {
+        while(from < end) {
+            auto word = bits[from / 64] >> (from % 64);
+            if(word) return std::min<Index>(end, from + Index(__builtin_ctzll(word)));
+            from = (from / 64 + 1) * 64;
+        }
+        return end;
+    }
+
+    // First id in [from, end) whose bit is clear, or [end].
+    inline Index next_miss(const MatchWord* bits, Index from, Index end) {
+        while(from < end) {
+            auto word = ~bits[from / 64] >> (from % 64);
+            if(word) return std::min<Index>(end, from + Index(__builtin_ctzll(word)));
+            from = (from / 64 + 1) * 64;
+        }
+        return end;
+    }
+
+    // Instruction sets the scanner can use. scan_isa() picks the best one the CPU supports.
+    enum class ScanIsa { scalar, sse2, avx2 };
+
+    ScanIsa scan_isa();
+    const char* scan_isa_name(ScanIsa isa);
+
+    // Sets bit i of [bits] (match_words(count) words) when masks[i] contains every bit of
+    // [include] and none of [exclude]. Bits past [count] in the last word are cleared. Only the
+    // masks are read, never component memory.
+    void scan_masks(const TypeMask* masks, Index count, const TypeMask& include,
+                    const TypeMask& exclude, MatchWord* bits, ScanIsa isa = scan_isa());
+}
@@ -0,0 +1,93 @@
+//===--------------------------------------------------------------------------------------------===
+// snapshot.hpp - Binary world snapshots
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace amyinorbit::ecs {
+    using byte = std::uint8_t;
+
+    constexpr std::uint32_t snapshot_magic = 0x53434554; // "TECS"
+    constexpr std::uint32_t snapshot_version = 2;
+
+    class SnapshotWriter {
+    public:
+        void write(const void* data, std::size_t size) {
+            if(!size) return;
+            auto offset = data_.size();
+            data_.resize(offset + size);
+            std::memcpy(data_.data() + offset, data, size);
+        }
+
+        template <typename T>
+        void write(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "only raw values can be written");
+            write(&value, sizeof(T));
+        }
+
+        std::vector<byte>& data() { return data_; }
+    private:
+        std::vector<byte> data_;
+    };
+
+    // Reads from a snapshot held in memory (or mapped from disk). Reads past the end throw.
+    class SnapshotReader {
+    public:
+        SnapshotReader(const byte* data, std::size_t size) : data_(data), end_(data + size) {}
+
+        const byte* take(std::size_t size) {
+            if(std::size_t(end_ - data_) < size) throw std::runtime_error("truncated ECS snapshot");
+            auto ptr = data_;
+            data_ += size;
+            return ptr;
+        }
+
+        void read(void* dst, std::size_t size) {
+            auto src = take(size);
+            if(size) std::memcpy(dst, src, size);
+        }
+
+        template <typename T>
+        T read() {
+            static_assert(std::is_trivially_copyable_v<T>, "only raw values can be read");
+            T value;
+            read(&value, sizeof(T));
+            return value;
+        }
+
+    private:
+        const byte* data_;
+        const byte* end_;
+    };
+
+    // Trivially-copyable components are copied in and out of snapshots as raw memory. Other
+    // components need a serializer hook, or snapshot() throws:
+    //
+    //     template <> struct serializer<Name> {
+    //         static void save(SnapshotWriter& out, const Name& name);
+    //         static Name load(SnapshotReader& in);
+    //     };
+    template <typename T>
+    struct serializer {};
+
+    template <typename T, typename = void>
+    struct has_serializer : std::false_type {};
+
+    template <typename T>
+    struct has_serializer<T, std::void_t<decltype(&serializer<T>::save)>> : std::true_type {};
+
+    template <typename T>
+    constexpr bool has_serializer_v = has_serializer<T>::value;
+
+    template <typename T>
+    constexpr bool is_raw_component_v = std::is_trivially_copyable_v<T> && !has_serializer_v<T>;
+}
@@ -0,0 +1,314 @@
+//===--------------------------------------------------------------------------------------------===
+// spatial.hpp - Spatial indices over entity positions
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <ecs/thread_pool.hpp>
+#include <ecs/world.hpp>
+
+namespace amyinorbit::ecs {
+
+    struct Point {
+        float x, y, z;
+    };
+
+    struct Box {
+        Point min, max;
+    };
+
+    // Tells SpatialIndex where a component sits. [radius] is optional and defaults to zero:
+    //
+    //     template <> struct spatial_traits<Thermal> {
+    //         static Point position(const Thermal& t) { return {t.x, t.y, t.z}; }
+    //         static float radius(const Thermal& t) { return t.radius; }
+    //     };
+    template <typename C>
+    struct spatial_traits;
+
+    // Entries are spheres (a centre and a radius) keyed by entity id, bucketed into cells. The
+    // backends differ in how they pick cells: HashGrid and LooseOctree below.
+    class SpatialCells {
+    public:
+        static constexpr Index npos = ~Index(0);
+
+        std::size_t size() const { return size_; }
+        bool contains(Index id) const { return id < entries_.size() && entries_[id].slot != npos; }
+
+        const Point& center(Index id) const { return entries_[id].center; }
+        float radius(Index id) const { return entries_[id].radius; }
+
+    protected:
+        struct Entry {
+            Point center;
+            float radius = 0.f;
+            std::uint64_t cell = 0;
+            Index slot = npos;
+        };
+
+        void place(Index id, const Point& center, float radius, std::uint64_t cell);
+        void remove(Index id);
+
+        // Calls fn(id) for every entry in [cell], if it exists.
+        template <typename F>
+        void visit(std::uint64_t cell, F& fn) const {
+            auto it = cells_.find(cell);
+            if(it == cells_.end()) return;
+            for(auto id: it->second) fn(id);
+        }
+
+        bool overlaps(Index id, const Box& box) const {
+            const auto& e = entries_[id];
+            return e.center.x + e.radius >= box.min.x && e.center.x - e.radius <= box.max.x
+                && e.center.y + e.radius >= box.min.y && e.center.y - e.radius <= box.max.y
+                && e.center.z + e.radius >= box.min.z && e.center.z - e.radius <= box.max.z;
+        }
+
+        bool overlaps(Index id, const Point& center, float radius) const {
+            const auto& e = entries_[id];
+            float dx = e.center.x - center.x;
+            float dy = e.center.y - center.y;
+            float dz = e.center.z - center.z;
+            float reach = e.radius + radius;
+            return dx * dx + dy * dy + dz * dz <= reach * reach;
+        }
+
+        std::vector<Entry> entries_;
+        std::unordered_map<std::uint64_t, std::vector<Index>> cells_;
+        std::size_t size_ = 0;
+    };
+
+    // Uniform grid of [cell_size] cubes, hashed so that only occupied cells use memory. Entries
+    // are bucketed by their centre; queries widen by the largest radius seen so far.
+    class HashGrid : public SpatialCells {
+    public:
+        explicit HashGrid(float cell_size = 10.f) : cell_size_(cell_size) {}
+
+        void insert(Index id, const Point& center, float radius = 0.f);
+        void erase(Index id) { remove(id); }
+
+        // Calls fn(id) for every entry whose sphere overlaps [box] / the query sphere.
+        template <typename F>
+        void query(const Box& box, F&& fn) const {
+            visit_box(box, [&](Index id) { if(overlaps(id, box)) fn(id); });
+        }
+
+        template <typename F>
+        void query(const Point& center, float radius, F&& fn) const {
+            Box box{{center.x - radius, center.y - radius, center.z - radius},
+                    {center.x + radius, center.y + radius, center.z + radius}};
+            visit_box(box, [&](Index id) { if(overlaps(id, center, radius)) fn(id); });
+        }
+
+    private:
+        template <typename F>
+        void visit_box(Box box, F&& fn) const;
+
+        std::int32_t cell(float v) const;
+        static std::uint64_t key(std::int32_t x, std::int32_t y, std::int32_t z);
+
+        float cell_size_;
+        float max_radius_ = 0.f;
+    };
+
+    // Loose octree over the cube centred on [center] with half-size [extent], stored as hashed
+    // cells per level. An entry lives at the deepest level whose cells are at least twice its
+    // radius, in the cell containing its centre; each cell's loose bounds are twice its size, so
+    // they always contain the whole entry. Entries outside the root live in the root.
+    class LooseOctree : public SpatialCells {
+    public:
+        static constexpr int max_depth = 10;
+
+        LooseOctree(const Point& center = {0, 0, 0}, float extent = 1000.f, int depth = 8);
+
+        void insert(Index id, const Point& center, float radius = 0.f);
+        void erase(Index id);
+
+        template <typename F>
+        void query(const Box& box, F&& fn) const {
+            visit_box(box, [&](Index id) { if(overlaps(id, box)) fn(id); });
+        }
+
+        template <typename F>
+        void query(const Point& center, float radius, F&& fn) const {
+            Box box{{center.x - radius, center.y - radius, center.z - radius},
+                    {center.x + radius, center.y + radius, center.z + radius}};
+            visit_box(box, [&](Index id) { if(overlaps(id, center, radius)) fn(id); });
+        }
+
+    private:
+        template <typename F>
+        void visit_box(const Box& box, F&& fn) const;
+
+        static std::uint64_t key(int level, std::uint32_t x, std::uint32_t y, std::uint32_t z);
+
+        Point origin_; // minimum corner of the root
+        float size_;   // edge length of the root
+        int depth_;
+        // Occupied cells per level, so large queries at deep levels can skip the cell ranges.
+        std::vector<std::unordered_map<std::uint64_t, Index>> occupied_;
+    };
+
+    // Keeps a spatial backend in sync with the entities that have component C. update() only
+    // re-buckets entities whose C changed since the previous update, and drops entities that lost
+    // C or were destroyed. Call it once per frame, before any system queries the index; queries
+    // are read-only and may run concurrently with each other.
+    template <typename C, typename Backend = HashGrid>
+    class SpatialIndex {
+    public:
+        using traits = spatial_traits<C>;
+
+        template <typename... Args>
+        explicit SpatialIndex(Args&&... args) : backend_(std::forward<Args>(args)...) {}
+
+        void update(World& world);
+
+        std::size_t size() const { return backend_.size(); }
+        const Backend& backend() const { return backend_; }
+
+        // Calls fn(Entity) for every entity overlapping the query shape.
+        template <typename F>
+        void query(const Point& center, float radius, F&& fn) const {
+            backend_.query(center, radius, [&](Index id) { fn(entities_[id]); });
+        }
+
+        template <typename F>
+        void query(const Box& box, F&& fn) const {
+            backend_.query(box, [&](Index id) { fn(entities_[id]); });
+        }
+
+        // Runs one radius query per centre on [pool]; results[i] receives the matches for
+        // centers[i].
+        void query(const Point* centers, std::size_t count, float radius,
+                   std::vector<Entity>* results, ThreadPool& pool = ThreadPool::shared()) const {
+            pool.parallel_for(0, Index(count), 64, [&](Index from, Index to) {
+                for(Index i = from; i < to; ++i) {
+                    results[i].clear();
+                    query(centers[i], radius, [&](Entity e) { results[i].push_back(e); });
+                }
+            });
+        }
+
+    private:
+        template <typename T, typename = void>
+        struct has_radius : std::false_type {};
+        template <typename T>
+        struct has_radius<T,
+            std::void_t<decltype(T::radius(std::declval<component_cref_t<C>>()))>>
+            : std::true_type {};
+
+        static float radius_of(component_cref_t<C> component) {
+            if constexpr(has_radius<traits>::value) {
+                return traits::radius(component);
+            } else {
+                return 0.f;
+            }
+        }
+
+        Backend backend_;
+        std::vector<Entity> entities_;
+        Tick since_ = 0;
+        std::uint64_t removals_ = 0; // world.removals<C>() at the last update
+    };
+
+    template <typename C, typename Backend>
+    void SpatialIndex<C, Backend>::update(World& world) {
+        for(const auto& item: world.query<Changed<const C>>(since_)) {
+            auto entity = item.entity();
+            const auto& component = item.template get<0>();
+            if(entity.id >= entities_.size()) entities_.resize(entity.id + 1);
+            entities_[entity.id] = entity;
+            backend_.insert(entity.id, traits::position(component), radius_of(component));
+        }
+
+        // Something lost C since the last update: find the entries whose entity is gone or no
+        // longer has C. Comparing entry counts instead is fooled when a stale entry and a missing
+        // one balance out.
+        auto removals = world.removals<C>();
+        if(removals != removals_) {
+            for(Index id = 0; id < entities_.size(); ++id) {
+                if(!backend_.contains(id)) continue;
+                auto entity = entities_[id];
+                bool live = id < world.size() && world.is_valid(entity);
+                if(!live || !world.has_component<C>(entity)) backend_.erase(id);
+            }
+            removals_ = removals;
+        }
+        since_ = world.tick();
+    }
+
+    // MARK: - Backend query templates
+
+    template <typename F>
+    void HashGrid::visit_box(Box box, F&& fn) const {
+        box.min = {box.min.x - max_radius_, box.min.y - max_radius_, box.min.z - max_radius_};
+        box.max = {box.max.x + max_radius_, box.max.y + max_radius_, box.max.z + max_radius_};
+        auto x0 = cell(box.min.x), x1 = cell(box.max.x);
+        auto y0 = cell(box.min.y), y1 = cell(box.max.y);
+        auto z0 = cell(box.min.z), z1 = cell(box.max.z);
+        for(auto z = z0; z <= z1; ++z) {
+            for(auto y = y0; y <= y1; ++y) {
+                for(auto x = x0; x <= x1; ++x) {
+                    visit(key(x, y, z), fn);
+                }
+            }
+        }
+    }
+
+    template <typename F>
+    void LooseOctree::visit_box(const Box& box, F&& fn) const {
+        // The root also holds everything that does not fit inside the tree.
+        visit(key(0, 0, 0, 0), fn);
+
+        for(int level = 1; level <= depth_; ++level) {
+            const auto& occupied = occupied_[level];
+            if(occupied.empty()) continue;
+
+            const std::int64_t cells = std::int64_t(1) << level;
+            const float cell = size_ / float(cells);
+            const float loose = cell * 0.5f;
+            auto range = [&](float lo, float hi, float origin, std::int64_t& from,
+                             std::int64_t& to) {
+                from = std::int64_t(std::floor((lo - loose - origin) / cell));
+                to = std::int64_t(std::floor((hi + loose - origin) / cell));
+                from = std::max<std::int64_t>(from, 0);
+                to = std::min<std::int64_t>(to, cells - 1);
+            };
+            std::int64_t x0, x1, y0, y1, z0, z1;
+            range(box.min.x, box.max.x, origin_.x, x0, x1);
+            range(box.min.y, box.max.y, origin_.y, y0, y1);
+            range(box.min.z, box.max.z, origin_.z, z0, z1);
+            if(x0 > x1 || y0 > y1 || z0 > z1) continue;
+
+            auto span = (x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1);
+            if(std::size_t(span) > occupied.size()) {
+                // Cheaper to test every occupied cell of this level against the range.
+                for(const auto& [cell_key, count]: occupied) {
+                    auto x = std::int64_t(cell_key & 0xfffff);
+                    auto y = std::int64_t((cell_key >> 20) & 0xfffff);
+                    auto z = std::int64_t((cell_key >> 40) & 0xfffff);
+                    if(x < x0 || x > x1 || y < y0 || y > y1 || z < z0 || z > z1) continue;
+                    visit(cell_key, fn);
+                }
+                continue;
+            }
+            for(auto z = z0; z <= z1; ++z) {
+                for(auto y = y0; y <= y1; ++y) {
+                    for(auto x = x0; x <= x1; ++x) {
+                        auto cell_key = key(level, std::uint32_t(x), std::uint32_t(y),
+                            std::uint32_t(z));
+                        visit(cell_key, fn);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,634 @@
+//===--------------------------------------------------------------------------------------------===
+// store.hpp - Component storage backends
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cassert>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <ecs/entity.hpp>
+#include <ecs/memory.hpp>
+#include <ecs/meta.hpp>
+#include <ecs/snapshot.hpp>
+
+namespace amyinorbit::ecs {
+
+    struct Store {
+        Store() = default;
+        Store(const Store&) = delete;
+        Store& operator=(const Store&) = delete;
+        virtual ~Store() = default;
+
+        virtual void destroy(Index index) = 0;
+        virtual TypeMask mask() const = 0;
+        virtual const void* key() const = 0;
+
+        // Telemetry: component name, backend, number of component slots allocated and total
+        // bytes held, bookkeeping included.
+        virtual const char* name() const = 0;
+        virtual const char* kind() const = 0;
+        virtual std::size_t capacity() const = 0;
+        virtual std::size_t bytes() const = 0;
+
+        // Snapshot support. [masks] holds the component masks of the world's [count] entities.
+        virtual void save(SnapshotWriter& out, const TypeMask* masks, Index count) const = 0;
+        virtual void load(SnapshotReader& in, const TypeMask* masks, Index count) = 0;
+    };
+
+    // Occupancy of one component store, see World::store_stats().
+    struct StoreStats {
+        Index component;
+        const char* name;
+        const char* kind;
+        Index live;
+        std::size_t capacity;
+        std::size_t bytes;
+    };
+
+    // Component memory is allocated in fixed-size chunks of ENTITIES_PER_CHUNK elements. Chunks are
+    // never moved once allocated, so references to components stay valid when the world grows.
+    // Chunks come from [resource], aligned to at least a cache line. [chunk_size] overrides the
+    // default of ENTITIES_PER_CHUNK elements per chunk, for stores that lay chunks out themselves.
+    struct ChunkedStore : Store {
+        ChunkedStore(std::size_t elt_size, std::size_t align,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+                     std::size_t chunk_size = 0);
+        ChunkedStore(ChunkedStore&& other);
+        ChunkedStore& operator=(ChunkedStore&& other);
+        virtual ~ChunkedStore();
+
+        byte* ptr(Index index) {
+            return chunks_[index / ENTITIES_PER_CHUNK] + (index % ENTITIES_PER_CHUNK) * elt_size_;
+        }
+
+        const byte* ptr(Index index) const {
+            return chunks_[index / ENTITIES_PER_CHUNK] + (index % ENTITIES_PER_CHUNK) * elt_size_;
+        }
+
+        void reserve(std::size_t count);
+        virtual std::size_t capacity() const { return chunks_.size() * ENTITIES_PER_CHUNK; }
+        virtual std::size_t bytes() const {
+            return chunks_.size() * (chunk_size_ + sizeof(Tick) * ENTITIES_PER_CHUNK);
+        }
+
+        // Tick at which the component at [index] was last written.
+        void mark(Index index, Tick tick) {
+            ticks_[index / ENTITIES_PER_CHUNK][index % ENTITIES_PER_CHUNK] = tick;
+        }
+        Tick changed(Index index) const {
+            return ticks_[index / ENTITIES_PER_CHUNK][index % ENTITIES_PER_CHUNK];
+        }
+
+        // Stamps [count] consecutive ids from [first], which must all be in one chunk.
+        void mark(Index first, Index count, Tick tick) {
+            assert(first % ENTITIES_PER_CHUNK + count <= ENTITIES_PER_CHUNK);
+            auto ticks = ticks_[first / ENTITIES_PER_CHUNK];
+            std::fill_n(ticks + first % ENTITIES_PER_CHUNK, count, tick);
+        }
+
+    protected:
+        byte* chunk(Index index) { return chunks_[index]; }
+        const byte* chunk(Index index) const { return chunks_[index]; }
+
+        // Writes the chunks covering the first [count] ids: change ticks always, and component
+        // bytes too if [raw] is set. Loading copies them straight back into chunk memory.
+        void save_chunks(SnapshotWriter& out, Index count, bool raw) const;
+        void load_chunks(SnapshotReader& in, bool raw);
+
+    private:
+        void release();
+
+        std::size_t elt_size_ = 0;
+        std::size_t chunk_size_ = 0;
+        std::size_t align_ = CACHE_LINE_SIZE;
+        std::pmr::memory_resource* resource_;
+        std::vector<byte*> chunks_;
+        std::vector<Tick*> ticks_;
+    };
+
+    template <typename T>
+    struct TypedStore : ChunkedStore {
+        TypedStore(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : ChunkedStore(sizeof(T), alignof(T), resource) {}
+
+        template <
+            typename... Args,
+            std::enable_if_t<!std::is_constructible_v<T, Args...>>* = nullptr
+        >
+        T& make(Index index, Args&&... args) {
+            reserve(index + 1);
+            return *(new (ptr(index)) T{std::forward<Args>(args)...});
+        }
+
+        template <
+            typename... Args,
+            std::enable_if_t<std::is_constructible_v<T, Args...>>* = nullptr
+        >
+        T& make(Index index, Args&&... args) {
+            reserve(index + 1);
+            return *(new (ptr(index)) T(std::forward<Args>(args)...));
+        }
+
+        // Copies [value] into the slots of [count] entities that do not have T yet, and stamps
+        // them with [tick]. Trivially copyable components are memcpy'd.
+        void fill(const Entity* entities, Index count, const T& value, Tick tick) {
+            Index last = 0;
+            for(Index i = 0; i < count; ++i) last = std::max(last, entities[i].id);
+            if(count) reserve(last + 1);
+            for(Index i = 0; i < count; ++i) {
+                auto id = entities[i].id;
+                if constexpr(std::is_trivially_copyable_v<T>) {
+                    std::memcpy(static_cast<void*>(ptr(id)), &value, sizeof(T));
+                } else {
+                    new (ptr(id)) T(value);
+                }
+                mark(id, tick);
+            }
+        }
+
+        virtual void destroy(Index index) { get(index).~T(); }
+        T& get(Index index) { return *ptr(index); }
+        const T& get(Index index) const { return *ptr(index); }
+
+        T* ptr(Index index) { return reinterpret_cast<T*>(ChunkedStore::ptr(index)); }
+        const T* ptr(Index index) const {
+            return reinterpret_cast<const T*>(ChunkedStore::ptr(index));
+        }
+
+        // Components of ids [first, first + n) are contiguous as long as they share a chunk.
+        T* span(Index first) { return ptr(first); }
+
+        TypeMask mask() const { return type_mask_v<T>; }
+        const void* key() const { return &type_key<T>; }
+        const char* name() const { return component_name<T>(); }
+        const char* kind() const { return "chunked"; }
+
+        void save(SnapshotWriter& out, const TypeMask* masks, Index count) const {
+            out.write<std::uint32_t>(sizeof(T));
+            if constexpr(is_raw_component_v<T>) {
+                save_chunks(out, count, true);
+            } else if constexpr(has_serializer_v<T>) {
+                save_chunks(out, count, false);
+                for(Index id = 0; id < count; ++id) {
+                    if(masks[id].test(component_id<T>())) serializer<T>::save(out, get(id));
+                }
+            } else {
+                throw std::runtime_error("component #" + std::to_string(component_id<T>())
+                    + " is not trivially copyable and has no snapshot serializer");
+            }
+        }
+
+        void load(SnapshotReader& in, const TypeMask* masks, Index count) {
+            if(in.read<std::uint32_t>() != sizeof(T)) {
+                throw std::runtime_error("snapshot component size mismatch");
+            }
+            if constexpr(is_raw_component_v<T>) {
+                load_chunks(in, true);
+            } else if constexpr(has_serializer_v<T>) {
+                load_chunks(in, false);
+                for(Index id = 0; id < count; ++id) {
+                    if(masks[id].test(component_id<T>())) new (ptr(id)) T(serializer<T>::load(in));
+                }
+            } else {
+                throw std::runtime_error("component #" + std::to_string(component_id<T>())
+                    + " is not trivially copyable and has no snapshot serializer");
+            }
+        }
+    private:
+    };
+
+    // A run of consecutive components in SoA storage: one pointer per field array, starting at the
+    // run's first entity. field<I>() is what vectorised loops want; span[i] builds the layout's
+    // reference type for code that would rather see whole components. T is const for read-only
+    // runs, which only hand out const field pointers.
+    template <typename T, typename Fields = typename soa_layout<std::remove_const_t<T>>::fields>
+    class SoASpan;
+
+    template <typename T, typename... Fs>
+    class SoASpan<T, type_list<Fs...>> {
+        using layout = soa_layout<std::remove_const_t<T>>;
+        static constexpr bool read_only = std::is_const_v<T>;
+    public:
+        using reference = std::conditional_t<read_only,
+            typename layout::const_reference, typename layout::reference>;
+
+        template <std::size_t I>
+        using field_type = std::conditional_t<read_only,
+            const nth_type_t<I, Fs...>, nth_type_t<I, Fs...>>;
+
+        SoASpan() = default;
+        explicit SoASpan(Fs*... fields) : fields_(fields...) {}
+
+        // Writable spans convert to read-only ones.
+        template <typename U, std::enable_if_t<read_only && std::is_same_v<const U, T>>* = nullptr>
+        SoASpan(const SoASpan<U>& other) : fields_(other.fields_) {}
+
+        template <std::size_t I>
+        field_type<I>* field() const { return std::get<I>(fields_); }
+
+        reference operator[](Index i) const { return at(i, std::index_sequence_for<Fs...>()); }
+
+    private:
+        template <typename, typename> friend class SoASpan;
+
+        template <std::size_t... Is>
+        reference at(Index i, std::index_sequence<Is...>) const {
+            return reference(std::get<Is>(fields_) + i...);
+        }
+
+        std::tuple<Fs*...> fields_;
+    };
+
+    // Struct-of-arrays storage for components that declare an soa_layout. Each chunk holds one
+    // contiguous, cache-aligned array per field, so a loop over a single field (positions, say)
+    // streams through that field only. Components are accessed through the layout's reference
+    // type, and field<I>(chunk) exposes the raw arrays to vectorised loops.
+    template <typename T>
+    struct SoAStore : ChunkedStore {
+        using layout = soa_layout<T>;
+        using reference = typename layout::reference;
+        using const_reference = typename layout::const_reference;
+
+        SoAStore(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : ChunkedStore(0, CACHE_LINE_SIZE, resource, layout_size()) {}
+
+        template <typename... Args>
+        reference make(Index index, Args&&... args) {
+            reserve(index + 1);
+            construct(index, typename layout::fields());
+            auto ref = get(index);
+            if constexpr(std::is_constructible_v<T, Args...>) {
+                ref = T(std::forward<Args>(args)...);
+            } else {
+                ref = T{std::forward<Args>(args)...};
+            }
+            return ref;
+        }
+
+        void fill(const Entity* entities, Index count, const T& value, Tick tick) {
+            Index last = 0;
+            for(Index i = 0; i < count; ++i) last = std::max(last, entities[i].id);
+            if(count) reserve(last + 1);
+            for(Index i = 0; i < count; ++i) {
+                construct(entities[i].id, typename layout::fields());
+                get(entities[i].id) = value;
+                mark(entities[i].id, tick);
+            }
+        }
+
+        virtual void destroy(Index index) { destroy(index, typename layout::fields()); }
+
+        reference get(Index index) { return get(index, typename layout::fields()); }
+        const_reference get(Index index) const {
+            return const_cast<SoAStore*>(this)->get(index, typename layout::fields());
+        }
+
+        SoASpan<T> span(Index first) { return span(first, typename layout::fields()); }
+
+        // Array of field I for the ENTITIES_PER_CHUNK ids of [chunk_index].
+        template <std::size_t I>
+        auto field(Index chunk_index) {
+            using F = typename field_type<I, typename layout::fields>::type;
+            return reinterpret_cast<F*>(chunk(chunk_index) + offset<I>(typename layout::fields()));
+        }
+
+        TypeMask mask() const { return type_mask_v<T>; }
+        const void* key() const { return &type_key<T>; }
+        const char* name() const { return component_name<T>(); }
+        const char* kind() const { return "soa"; }
+
+        void save(SnapshotWriter& out, const TypeMask*, Index count) const {
+            check_raw(typename layout::fields());
+            out.write<std::uint32_t>(std::uint32_t(layout_size()));
+            save_chunks(out, count, true);
+        }
+
+        void load(SnapshotReader& in, const TypeMask*, Index) {
+            check_raw(typename layout::fields());
+            if(in.read<std::uint32_t>() != layout_size()) {
+                throw std::runtime_error("snapshot component size mismatch");
+            }
+            load_chunks(in, true);
+        }
+
+    private:
+        template <std::size_t I, typename L> struct field_type;
+        template <std::size_t I, typename... Fs>
+        struct field_type<I, type_list<Fs...>> { using type = nth_type_t<I, Fs...>; };
+
+        static constexpr std::size_t aligned(std::size_t size) {
+            return (size + CACHE_LINE_SIZE - 1) & ~std::size_t(CACHE_LINE_SIZE - 1);
+        }
+
+        template <typename... Fs>
+        static constexpr std::size_t layout_size(type_list<Fs...>) {
+            static_assert(((alignof(Fs) <= CACHE_LINE_SIZE) && ...), "over-aligned SoA field");
+            return (aligned(sizeof(Fs) * ENTITIES_PER_CHUNK) + ... + 0);
+        }
+        static constexpr std::size_t layout_size() {
+            return layout_size(typename layout::fields());
+        }
+
+        // Byte offset of field I's array within a chunk.
+        template <std::size_t I, typename... Fs>
+        static constexpr std::size_t offset(type_list<Fs...>) {
+            constexpr std::size_t sizes[] = {aligned(sizeof(Fs) * ENTITIES_PER_CHUNK)...};
+            std::size_t result = 0;
+            for(std::size_t i = 0; i < I; ++i) result += sizes[i];
+            return result;
+        }
+
+        template <typename... Fs, std::size_t... Is>
+        void construct(Index index, type_list<Fs...>, std::index_sequence<Is...>) {
+            (new (field<Is>(index / ENTITIES_PER_CHUNK) + index % ENTITIES_PER_CHUNK) Fs(), ...);
+        }
+        template <typename... Fs>
+        void construct(Index index, type_list<Fs...> fields) {
+            construct(index, fields, std::index_sequence_for<Fs...>());
+        }
+
+        template <typename... Fs, std::size_t... Is>
+        void destroy(Index index, type_list<Fs...>, std::index_sequence<Is...>) {
+            (field<Is>(index / ENTITIES_PER_CHUNK)[index % ENTITIES_PER_CHUNK].~Fs(), ...);
+        }
+        template <typename... Fs>
+        void destroy(Index index, type_list<Fs...> fields) {
+            destroy(index, fields, std::index_sequence_for<Fs...>());
+        }
+
+        template <typename... Fs, std::size_t... Is>
+        reference get(Index index, type_list<Fs...>, std::index_sequence<Is...>) {
+            return reference(field<Is>(index / ENTITIES_PER_CHUNK) + index % ENTITIES_PER_CHUNK...);
+        }
+        template <typename... Fs>
+        reference get(Index index, type_list<Fs...> fields) {
+            return get(index, fields, std::index_sequence_for<Fs...>());
+        }
+
+        template <typename... Fs, std::size_t... Is>
+        SoASpan<T> span(Index first, type_list<Fs...>, std::index_sequence<Is...>) {
+            auto chunk_index = first / ENTITIES_PER_CHUNK;
+            return SoASpan<T>(field<Is>(chunk_index) + first % ENTITIES_PER_CHUNK...);
+        }
+        template <typename... Fs>
+        SoASpan<T> span(Index first, type_list<Fs...> fields) {
+            return span(first, fields, std::index_sequence_for<Fs...>());
+        }
+
+        template <typename... Fs>
+        static void check_raw(type_list<Fs...>) {
+            if constexpr(!(std::is_trivially_copyable_v<Fs> && ...)) {
+                throw std::runtime_error("component #" + std::to_string(component_id<T>())
+                    + " has SoA fields that are not trivially copyable");
+            }
+        }
+    };
+
+    // Sparse-set pool: a paged sparse array maps entity ids to slots in a packed dense array of
+    // components and owners. Iteration costs O(live components), and removal swaps the last
+    // component into the hole so the dense array never fragments. Since components move on
+    // removal, references into a sparse pool are only stable until the next add or remove.
+    template <typename T>
+    struct SparseStore : Store {
+        static constexpr Index npos = ~Index(0);
+
+        SparseStore(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : resource_(resource)
+            , pages_(resource)
+            , dense_(resource)
+            , owners_(resource)
+            , ticks_(resource) {}
+
+        ~SparseStore() {
+            for(auto page: pages_) {
+                if(page) resource_->deallocate(page, page_bytes, CACHE_LINE_SIZE);
+            }
+        }
+
+        template <typename... Args>
+        T& make(Index index, Args&&... args) {
+            auto& slot = sparse(index);
+            assert(slot == npos);
+            slot = Index(dense_.size());
+            owners_.push_back(index);
+            ticks_.push_back(0);
+            if constexpr(std::is_constructible_v<T, Args...>) {
+                dense_.emplace_back(std::forward<Args>(args)...);
+            } else {
+                dense_.push_back(T{std::forward<Args>(args)...});
+            }
+            return dense_.back();
+        }
+
+        void fill(const Entity* entities, Index count, const T& value, Tick tick) {
+            dense_.reserve(dense_.size() + count);
+            owners_.reserve(owners_.size() + count);
+            ticks_.reserve(ticks_.size() + count);
+            for(Index i = 0; i < count; ++i) {
+                make(entities[i].id, value);
+                ticks_.back() = tick;
+            }
+        }
+
+        virtual void destroy(Index index) {
+            auto& slot = sparse(index);
+            assert(slot != npos);
+            auto last = Index(dense_.size() - 1);
+            if(slot != last) {
+                dense_[slot] = std::move(dense_[last]);
+                owners_[slot] = owners_[last];
+                ticks_[slot] = ticks_[last];
+                sparse(owners_[slot]) = slot;
+            }
+            dense_.pop_back();
+            owners_.pop_back();
+            ticks_.pop_back();
+            slot = npos;
+        }
+
+        T& get(Index index) { return dense_[slot(index)]; }
+        const T& get(Index index) const { return dense_[slot(index)]; }
+
+        void mark(Index index, Tick tick) { ticks_[slot(index)] = tick; }
+        Tick changed(Index index) const { return ticks_[slot(index)]; }
+
+        Index size() const { return Index(dense_.size()); }
+        const Index* owners() const { return owners_.data(); }
+        T* data() { return dense_.data(); }
+        const T* data() const { return dense_.data(); }
+
+        TypeMask mask() const { return type_mask_v<T>; }
+        const void* key() const { return &type_key<T>; }
+        const char* name() const { return component_name<T>(); }
+        const char* kind() const { return "sparse"; }
+
+        std::size_t capacity() const { return dense_.capacity(); }
+        std::size_t bytes() const {
+            auto pages = std::count_if(pages_.begin(), pages_.end(), [](auto p) { return p; });
+            return std::size_t(pages) * page_bytes + pages_.capacity() * sizeof(Index*)
+                + dense_.capacity() * sizeof(T) + owners_.capacity() * sizeof(Index)
+                + ticks_.capacity() * sizeof(Tick);
+        }
+
+        void save(SnapshotWriter& out, const TypeMask*, Index) const {
+            if constexpr(!is_raw_component_v<T> && !has_serializer_v<T>) {
+                throw std::runtime_error("component #" + std::to_string(component_id<T>())
+                    + " is not trivially copyable and has no snapshot serializer");
+            }
+            out.write<std::uint32_t>(sizeof(T));
+            out.write<std::uint32_t>(size());
+            out.write(owners_.data(), owners_.size() * sizeof(Index));
+            out.write(ticks_.data(), ticks_.size() * sizeof(Tick));
+            if constexpr(is_raw_component_v<T>) {
+                out.write(dense_.data(), dense_.size() * sizeof(T));
+            } else if constexpr(has_serializer_v<T>) {
+                for(const auto& component: dense_) serializer<T>::save(out, component);
+            }
+        }
+
+        void load(SnapshotReader& in, const TypeMask*, Index) {
+            if constexpr(!is_raw_component_v<T> && !has_serializer_v<T>) {
+                throw std::runtime_error("component #" + std::to_string(component_id<T>())
+                    + " is not trivially copyable and has no snapshot serializer");
+            }
+            if(in.read<std::uint32_t>() != sizeof(T)) {
+                throw std::runtime_error("snapshot component size mismatch");
+            }
+            assert(dense_.empty());
+            auto count = in.read<std::uint32_t>();
+            owners_.resize(count);
+            ticks_.resize(count);
+            in.read(owners_.data(), count * sizeof(Index));
+            in.read(ticks_.data(), count * sizeof(Tick));
+            for(Index i = 0; i < count; ++i) {
+                sparse(owners_[i]) = i;
+            }
+
+            if constexpr(is_raw_component_v<T> && std::is_default_constructible_v<T>) {
+                dense_.resize(count);
+                in.read(dense_.data(), count * sizeof(T));
+            } else if constexpr(is_raw_component_v<T>) {
+                dense_.reserve(count);
+                for(Index i = 0; i < count; ++i) {
+                    alignas(T) byte buffer[sizeof(T)];
+                    in.read(buffer, sizeof(T));
+                    dense_.push_back(*reinterpret_cast<const T*>(buffer));
+                }
+            } else if constexpr(has_serializer_v<T>) {
+                dense_.reserve(count);
+                for(Index i = 0; i < count; ++i) {
+                    dense_.push_back(serializer<T>::load(in));
+                }
+            }
+        }
+    private:
+        Index slot(Index index) const {
+            return pages_[index / ENTITIES_PER_CHUNK][index % ENTITIES_PER_CHUNK];
+        }
+
+        Index& sparse(Index index) {
+            auto page = index / ENTITIES_PER_CHUNK;
+            if(page >= pages_.size()) pages_.resize(page + 1);
+            if(!pages_[page]) {
+                pages_[page] = static_cast<Index*>(
+                    resource_->allocate(page_bytes, CACHE_LINE_SIZE));
+                std::fill_n(pages_[page], ENTITIES_PER_CHUNK, npos);
+            }
+            return pages_[page][index % ENTITIES_PER_CHUNK];
+        }
+
+        static constexpr std::size_t page_bytes = ENTITIES_PER_CHUNK * sizeof(Index);
+
+        std::pmr::memory_resource* resource_;
+        aligned_vector<Index*> pages_;
+        aligned_vector<T> dense_;
+        aligned_vector<Index> owners_;
+        aligned_vector<Tick> ticks_;
+    };
+
+    // Storage for empty (tag) components: an entity has the tag if its mask bit is set, and that
+    // bit is all the tag costs. Every entity shares the same instance, and tags carry no change
+    // ticks, so they cannot be used in Changed<C> terms.
+    template <typename T>
+    struct TagStore : Store {
+        static_assert(std::is_empty_v<T>, "tag components must be empty types");
+
+        TagStore(std::pmr::memory_resource* = nullptr) {}
+
+        template <typename... Args>
+        T& make(Index, Args&&...) { return instance_; }
+        void fill(const Entity*, Index, const T&, Tick) {}
+
+        virtual void destroy(Index) {}
+        T& get(Index) { return instance_; }
+        const T& get(Index) const { return instance_; }
+
+        void mark(Index, Tick) {}
+
+        TypeMask mask() const { return type_mask_v<T>; }
+        const void* key() const { return &type_key<T>; }
+        const char* name() const { return component_name<T>(); }
+        const char* kind() const { return "tag"; }
+        std::size_t capacity() const { return 0; }
+        std::size_t bytes() const { return 0; }
+
+        // Tags live in the snapshot's entity masks.
+        void save(SnapshotWriter&, const TypeMask*, Index) const {}
+        void load(SnapshotReader&, const TypeMask*, Index) {}
+
+    private:
+        T instance_;
+    };
+
+    // Selects the storage backend for a component type. Components default to chunked, id-indexed
+    // stores; short-lived or rare components can opt into sparse-set pools:
+    //
+    //     template <> struct storage_for<InThermal> { using type = SparseStore<InThermal>; };
+    //
+    // Components that declare an soa_layout use struct-of-arrays chunks, and empty components are
+    // tags that only take a mask bit.
+    template <typename T>
+    struct storage_for {
+        using type = std::conditional_t<std::is_empty_v<T>, TagStore<T>,
+            std::conditional_t<is_soa_v<T>, SoAStore<T>, TypedStore<T>>>;
+    };
+
+    template <typename T>
+    using storage_t = typename storage_for<T>::type;
+
+    template <typename T>
+    constexpr bool is_sparse_v = std::is_same_v<storage_t<T>, SparseStore<T>>;
+
+    template <typename T>
+    constexpr bool is_tag_v = std::is_same_v<storage_t<T>, TagStore<T>>;
+
+    // What a chunk query hands out for query term Q: a plain pointer to the first component of a
+    // run, or an SoASpan for struct-of-arrays components.
+    template <typename Q, typename = void>
+    struct span_type {
+        using type = std::conditional_t<query_traits<Q>::read_only,
+            const component_t<Q>*, component_t<Q>*>;
+    };
+
+    template <typename Q>
+    struct span_type<Q, std::enable_if_t<is_soa_v<component_t<Q>>>> {
+        using type = std::conditional_t<query_traits<Q>::read_only,
+            SoASpan<const component_t<Q>>, SoASpan<component_t<Q>>>;
+    };
+
+    template <typename Q>
+    using span_t = typename span_type<Q>::type;
+}
@@ -0,0 +1,108 @@
+//===--------------------------------------------------------------------------------------------===
+// system.hpp - Systems with declared component access, and a parallel scheduler
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <memory>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include <ecs/telemetry.hpp>
+#include <ecs/world.hpp>
+#include <ecs/thread_pool.hpp>
+
+namespace amyinorbit::ecs {
+
+    template <typename... Cs>
+    struct Reads {
+        static constexpr TypeMask mask() { return type_mask<Cs...>(); }
+        static void prepare(World& world) { world.prepare<Cs...>(); }
+    };
+
+    template <typename... Cs>
+    struct Writes {
+        static constexpr TypeMask mask() { return type_mask<Cs...>(); }
+        static void prepare(World& world) { world.prepare<Cs...>(); }
+    };
+
+    class SystemBase {
+    public:
+        virtual ~SystemBase() = default;
+
+        virtual void run(World& world, float dt) = 0;
+
+        // Name shown in telemetry. Defaults to the (mangled) type name.
+        virtual const char* name() const { return typeid(*this).name(); }
+
+        virtual TypeMask reads() const = 0;
+        virtual TypeMask writes() const = 0;
+        virtual void prepare(World& world) const = 0;
+
+        // Two systems conflict if either one writes a component the other accesses.
+        bool conflicts(const SystemBase& other) const {
+            return writes().intersects(other.reads() | other.writes())
+                || other.writes().intersects(reads());
+        }
+    };
+
+    // Base class for user systems, which declare the components they access:
+    //
+    //     struct Integrate : System<Reads<Velocity>, Writes<Transform>> {
+    //         void run(World& world, float dt) override;
+    //     };
+    template <typename R, typename W>
+    class System : public SystemBase {
+    public:
+        using ReadList = R;
+        using WriteList = W;
+
+        TypeMask reads() const final { return R::mask(); }
+        TypeMask writes() const final { return W::mask(); }
+        void prepare(World& world) const final {
+            R::prepare(world);
+            W::prepare(world);
+        }
+    };
+
+    // Runs registered systems once per frame. Each frame, a dependency graph is built from the
+    // declared access sets: a system waits on every earlier-registered system it conflicts with,
+    // and systems with no pending dependencies run concurrently on the thread pool. Structural
+    // changes must go through World::commands(); they are flushed once all systems are done.
+    class Scheduler {
+    public:
+        Scheduler(ThreadPool& pool = ThreadPool::shared()) : pool_(pool) {}
+
+        template <typename S, typename... Args>
+        S& add(Args&&... args) {
+            auto system = new S(std::forward<Args>(args)...);
+            systems_.emplace_back(system);
+            return *system;
+        }
+
+        std::size_t size() const { return systems_.size(); }
+
+        void run(World& world, float dt);
+
+    private:
+        struct Node {
+            std::vector<std::size_t> dependents;
+            std::size_t dependencies = 0;
+            std::atomic<std::size_t> waiting{0};
+        };
+
+        void build();
+        void launch(std::size_t index, World& world, float dt);
+
+        ThreadPool& pool_;
+        std::vector<std::unique_ptr<SystemBase>> systems_;
+        std::unique_ptr<Node[]> nodes_;
+        std::atomic<std::size_t> remaining_{0};
+#if ECS_TELEMETRY
+        telemetry::Scope* frame_ = nullptr;
+#endif
+    };
+}
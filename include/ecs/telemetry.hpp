@@ -0,0 +1,231 @@
+//===--------------------------------------------------------------------------------------------===
+// telemetry.hpp - Frame, system and query instrumentation
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <ecs/entity.hpp>
+#include <ecs/memory.hpp>
+#include <ecs/meta.hpp>
+
+// Telemetry is on in debug builds and compiled out when NDEBUG is defined. Define ECS_TELEMETRY
+// to 0 or 1 to override that, the same way for every translation unit.
+#ifndef ECS_TELEMETRY
+#ifdef NDEBUG
+#define ECS_TELEMETRY 0
+#else
+#define ECS_TELEMETRY 1
+#endif
+#endif
+
+namespace amyinorbit::ecs {
+    class World;
+}
+
+namespace amyinorbit::ecs::telemetry {
+
+    constexpr bool enabled = ECS_TELEMETRY;
+
+    enum class Kind : std::uint8_t { frame, system, query, store };
+
+    const char* kind_name(Kind kind);
+
+    // One measurement. Frames, systems and queries record their wall time and the number of
+    // entities they visited; stores record their live count, capacity and bytes. [name] always
+    // points to a string with static lifetime, so samples can be copied around freely.
+    struct Sample {
+        Kind kind;
+        const char* name;
+        std::uint64_t frame;
+        std::uint64_t wall_ns;
+        std::uint64_t entities;
+        std::uint64_t capacity;
+        std::uint64_t bytes;
+    };
+
+    // Bounded multi-producer, single-consumer queue (Vyukov's sequenced ring). Producers claim a
+    // slot with one CAS and never wait; when the ring is full, push() fails instead of blocking.
+    template <typename T, std::size_t N>
+    class RingBuffer {
+        static_assert(N && !(N & (N - 1)), "ring buffer size must be a power of two");
+    public:
+        RingBuffer() {
+            for(std::size_t i = 0; i < N; ++i) {
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool push(const T& value) {
+            auto pos = head_.load(std::memory_order_relaxed);
+            for(;;) {
+                auto& slot = slots_[pos & (N - 1)];
+                auto seq = slot.sequence.load(std::memory_order_acquire);
+                auto diff = std::intptr_t(seq) - std::intptr_t(pos);
+                if(diff == 0) {
+                    if(head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        slot.value = value;
+                        slot.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if(diff < 0) {
+                    return false;
+                } else {
+                    pos = head_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Consumer thread only.
+        bool pop(T& out) {
+            auto& slot = slots_[tail_ & (N - 1)];
+            if(slot.sequence.load(std::memory_order_acquire) != tail_ + 1) return false;
+            out = slot.value;
+            slot.sequence.store(tail_ + N, std::memory_order_release);
+            tail_ += 1;
+            return true;
+        }
+
+    private:
+        struct Slot {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        Slot slots_[N];
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_{0};
+        alignas(CACHE_LINE_SIZE) std::size_t tail_ = 0;
+    };
+
+    inline std::uint64_t now_ns() {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+#if ECS_TELEMETRY
+    // Queues [sample] for the monitor. Never blocks: samples are dropped if nobody drains them.
+    void record(const Sample& sample);
+
+    // Current frame number, advanced once per Scheduler::run().
+    std::uint64_t frame();
+    std::uint64_t next_frame();
+
+    // Records the occupancy of every store in [world], at most a few times per second.
+    void sample_stores(const World& world);
+
+    // Entities visited by views on the calling thread so far; scopes use the difference.
+    std::uint64_t& visited();
+
+    // Times a frame or a system from construction to destruction, along with the entities that
+    // views visited on this thread in the meantime. Nested scopes that run on other threads (a
+    // frame's systems, say) add their counts to their [parent] when they end.
+    class Scope {
+    public:
+        Scope(Kind kind, const char* name, Scope* parent = nullptr)
+            : kind_(kind), name_(name), parent_(parent), start_(now_ns()), visited_(visited()) {}
+        ~Scope() {
+            auto total = visited() - visited_ + children_.load(std::memory_order_relaxed);
+            if(parent_) parent_->children_.fetch_add(total, std::memory_order_relaxed);
+            record(Sample{kind_, name_, frame(), now_ns() - start_, total, 0, 0});
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Kind kind_;
+        const char* name_;
+        Scope* parent_;
+        std::uint64_t start_;
+        std::uint64_t visited_;
+        std::atomic<std::uint64_t> children_{0};
+    };
+
+    // Owned by a view from its first begin() to its destruction. Iterators count the entities
+    // they hand out; parallel loops add theirs atomically.
+    class QueryProbe {
+    public:
+        explicit QueryProbe(const char* name) : name_(name), start_(now_ns()) {}
+        ~QueryProbe() {
+            auto total = visited_ + shared_.load(std::memory_order_relaxed);
+            visited() += total;
+            record(Sample{Kind::query, name_, frame(), now_ns() - start_, total, 0, 0});
+        }
+        QueryProbe(const QueryProbe&) = delete;
+        QueryProbe& operator=(const QueryProbe&) = delete;
+
+        void visit(std::uint64_t count = 1) { visited_ += count; }
+        void visit_shared(std::uint64_t count) {
+            shared_.fetch_add(count, std::memory_order_relaxed);
+        }
+
+    private:
+        const char* name_;
+        std::uint64_t start_;
+        std::uint64_t visited_ = 0;
+        std::atomic<std::uint64_t> shared_{0};
+    };
+
+    // "Transform, const Model, Changed<Parent>" for a query over those terms.
+    template <typename Q>
+    std::string term_name() {
+        std::string name = component_name<Q>();
+        if(query_traits<Q>::read_only) name = "const " + name;
+        if(query_traits<Q>::changed) name = "Changed<" + name + ">";
+        return name;
+    }
+
+    template <typename... Qs>
+    const char* query_name() {
+        static const std::string name = [] {
+            std::string out;
+            ((out += (out.empty() ? "" : ", ") + term_name<Qs>()), ...);
+            return out;
+        }();
+        return name.c_str();
+    }
+#endif
+
+    // Consumer side: drains recorded samples, keeps running statistics for each frame, system,
+    // query and store, and a bounded history for CSV export. Use from one thread only.
+    class Monitor {
+    public:
+        struct Series {
+            Kind kind;
+            const char* key;
+            std::string name;
+            std::uint64_t calls = 0;
+            double last_ms = 0;
+            double average_ms = 0; // exponential moving average
+            double max_ms = 0;
+            std::uint64_t entities = 0; // latest sample
+            std::uint64_t capacity = 0;
+            std::uint64_t bytes = 0;
+        };
+
+        explicit Monitor(std::size_t history = 1 << 16) : history_size_(history) {}
+
+        void update();
+
+        const std::vector<Series>& series() const { return series_; }
+        std::uint64_t dropped() const;
+
+        // Writes the kept history as frame,kind,name,wall_ns,entities,capacity,bytes rows.
+        bool dump_csv(const std::string& path) const;
+
+    private:
+        Series& find(const Sample& sample);
+
+        std::size_t history_size_;
+        std::deque<Sample> history_;
+        std::vector<Series> series_;
+    };
+}
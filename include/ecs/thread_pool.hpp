@@ -0,0 +1,71 @@
+//===--------------------------------------------------------------------------------------------===
+// thread_pool.hpp - Work-stealing thread pool used by parallel queries
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <ecs/entity.hpp>
+
+namespace amyinorbit::ecs {
+
+    // Each worker owns a task deque: it pushes and pops at the back, and idle workers steal from
+    // the front of the others. Threads that wait on the pool (parallel_for, wait) run tasks too
+    // instead of blocking.
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(unsigned workers = default_workers());
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        static ThreadPool& shared();
+        static unsigned default_workers();
+
+        // Number of threads that execute tasks, including the waiting caller.
+        unsigned concurrency() const { return unsigned(threads_.size()) + 1; }
+
+        void submit(Task task);
+
+        // Runs tasks until [remaining] drops to zero.
+        void wait(const std::atomic<std::size_t>& remaining);
+
+        // Splits [begin, end) into ranges of at most [grain] and calls fn(from, to) on each,
+        // returning once all of them have completed.
+        void parallel_for(Index begin, Index end, Index grain,
+                          const std::function<void(Index, Index)>& fn);
+
+    private:
+        struct Queue {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        bool pop(unsigned index, Task& task);
+        bool steal(unsigned index, Task& task);
+        bool find_task(Task& task);
+        void work(unsigned index);
+
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> threads_;
+
+        std::mutex sleep_lock_;
+        std::condition_variable wake_;
+        std::atomic<std::size_t> pending_{0};
+        std::atomic<unsigned> next_queue_{0};
+        bool done_ = false;
+    };
+}
@@ -8,12 +8,22 @@
 //===--------------------------------------------------------------------------------------------===
 #pragma once
 #include <ecs/proxy.hpp>
+#include <ecs/scan.hpp>
+#include <ecs/store.hpp>
+#include <ecs/telemetry.hpp>
+#include <ecs/thread_pool.hpp>
+#include <algorithm>
 #include <iterator>
+#include <memory>
+#include <tuple>
+#include <vector>
 
 namespace amyinorbit::ecs {
 
     class World;
 
+    // Iteration walks either a bitset of matching entity ids (found with a vectorised mask scan),
+    // or a packed list of candidate ids whose masks are tested one by one.
     template <typename... Cs>
     class EntityIterator {
     public:
@@ -22,8 +32,11 @@ namespace amyinorbit::ecs {
         using reference = Proxy<Cs...>;
         using const_reference = const Proxy<Cs...>;
 
-        EntityIterator() : world_(nullptr), index_(MAX_COMPONENTS) {}
-        EntityIterator(World* world, Index index) : world_(world), index_(index) { next(); }
+        EntityIterator() {}
+        EntityIterator(World* world, const Index* ids, const MatchWord* bits, Index index,
+                       Index end, Tick since, const TypeMask& exclude)
+            : world_(world), ids_(ids), bits_(bits), index_(index), end_(end), since_(since)
+            , exclude_(exclude) { start(); }
 
         bool operator==(const EntityIterator& other) const { return index_ == other.index_; }
         bool operator!=(const EntityIterator& other) const { return index_ != other.index_; }
@@ -31,17 +44,207 @@ namespace amyinorbit::ecs {
         EntityIterator& operator++();
         reference operator*() const;
 
+        // Runs fn(query_ref_t<Cs>...) over [this, last) on a thread pool, one storage chunk per
+        // task. Iterators over an id list split the list into chunk-sized slices instead.
+        template <typename F>
+        void par_each(const EntityIterator& last, ThreadPool& pool, F& fn) const;
+
+    private:
+        Index id() const { return ids_ ? ids_[index_] : index_; }
+        void start();
+        void next_bit();
+        void next_id();
+
+        template <typename T> friend class View;
+
+        World* world_ = nullptr;
+        const Index* ids_ = nullptr;
+        const MatchWord* bits_ = nullptr;
+        MatchWord word_ = 0; // match bits of index_'s word that come after index_
+        Index index_ = 0;
+        Index end_ = 0;
+        Tick since_ = 0;
+        TypeMask exclude_;
+#if ECS_TELEMETRY
+        telemetry::QueryProbe* probe_ = nullptr;
+#endif
+    };
+
+    // A run of [count] matching entities with consecutive ids, starting at [first], whose
+    // components all sit in one storage chunk. Binds as (count, span_t<Cs>...):
+    //
+    //     for(auto [count, position, velocity]: world.with<Position, const Velocity>().chunks()) {
+    //         for(Index i = 0; i < count; ++i) position[i] += velocity[i] * dt;
+    //     }
+    //
+    // Non-const terms are marked as changed for the whole run up front.
+    template <typename... Cs>
+    struct Chunk {
+        Index first;
+        Index count;
+        std::tuple<span_t<Cs>...> spans;
+
+        template <std::size_t N>
+        auto get() const {
+            if constexpr(N == 0) {
+                return count;
+            } else {
+                return std::get<N - 1>(spans);
+            }
+        }
+    };
+
+    // Walks the same entities as EntityIterator, but stops once per run instead of once per
+    // entity. Runs end at chunk boundaries, at gaps in the ids, and at entities that fail a
+    // Changed<C> term.
+    template <typename... Cs>
+    class ChunkIterator {
+    public:
+        using iterator_tag = std::input_iterator_tag;
+        using value_type = Chunk<Cs...>;
+        using reference = Chunk<Cs...>;
+
+        ChunkIterator() {}
+        ChunkIterator(World* world, const Index* ids, const MatchWord* bits, Index index,
+                      Index end, Tick since, const TypeMask& exclude)
+            : world_(world), ids_(ids), bits_(bits), index_(index), end_(end), since_(since)
+            , exclude_(exclude) { find(); }
+
+        bool operator==(const ChunkIterator& other) const { return index_ == other.index_; }
+        bool operator!=(const ChunkIterator& other) const { return index_ != other.index_; }
+
+        ChunkIterator& operator++() {
+            index_ += count_;
+            find();
+            return *this;
+        }
+
+        reference operator*() const;
+
     private:
-        void next();
+        static constexpr bool filtered = (query_traits<Cs>::changed || ...);
+
+        Index id() const { return ids_ ? ids_[index_] : index_; }
+        bool accept(Index id) const;
+        void find();
+
+        template <typename T> friend class View;
 
         World* world_ = nullptr;
-        Index index_ = MAX_COMPONENTS;
+        const Index* ids_ = nullptr;
+        const MatchWord* bits_ = nullptr;
+        Index index_ = 0;
+        Index count_ = 0;
+        Index end_ = 0;
+        Tick since_ = 0;
+        TypeMask exclude_;
+#if ECS_TELEMETRY
+        telemetry::QueryProbe* probe_ = nullptr;
+#endif
     };
 
     template <typename T>
-    struct View {
-        T begin() const { return begin_; }
-        T end() const { return end_; }
-        T begin_, end_;
+    class View;
+
+    // The entities of a world that have every component in Cs. Views over all entities scan the
+    // world's masks when iteration starts, so filters added with without() cost nothing extra;
+    // views over a candidate list (a cached query or a sparse pool) test each candidate's mask.
+    template <typename... Cs>
+    class View<EntityIterator<Cs...>> {
+    public:
+        using iterator = EntityIterator<Cs...>;
+
+        View(World* world, const Index* ids, Index count, Tick since,
+             const TypeMask& exclude = TypeMask())
+            : world_(world), ids_(ids), count_(count), since_(since), exclude_(exclude) {}
+
+        iterator begin() const;
+        iterator end() const {
+            return iterator(world_, ids_, nullptr, count_, count_, since_, exclude_);
+        }
+
+        // Same view, minus the entities that have any of Xs. Only masks are read to filter them,
+        // so Xs can be tags.
+        template <typename... Xs>
+        View without() const {
+            return View(world_, ids_, count_, since_, exclude_ | type_mask_v<Xs...>);
+        }
+
+        template <typename F>
+        void par_each(F&& fn, ThreadPool& pool = ThreadPool::shared()) const {
+            begin().par_each(end(), pool, fn);
+        }
+
+        // The same entities, as runs of contiguous components.
+        View<ChunkIterator<Cs...>> chunks() const;
+
+    private:
+        const MatchWord* bits() const;
+
+        World* world_;
+        const Index* ids_;
+        Index count_;
+        Tick since_;
+        TypeMask exclude_;
+        // Shared so that copies of the view (and their iterators) see the same scan.
+        mutable std::shared_ptr<std::vector<MatchWord>> bits_;
+#if ECS_TELEMETRY
+        // Times the view from its first begin() until the last copy goes away.
+        mutable std::shared_ptr<telemetry::QueryProbe> probe_;
+#endif
+    };
+
+    // Chunk-wise view of the entities of a View<EntityIterator<Cs...>>.
+    template <typename... Cs>
+    class View<ChunkIterator<Cs...>> {
+    public:
+        using iterator = ChunkIterator<Cs...>;
+
+        View(World* world, const Index* ids, const MatchWord* bits, Index count, Tick since,
+             const TypeMask& exclude, std::shared_ptr<std::vector<MatchWord>> keep)
+            : world_(world), ids_(ids), bits_(bits), count_(count), since_(since)
+            , exclude_(exclude), keep_(std::move(keep)) {}
+
+        iterator begin() const;
+        iterator end() const {
+            return iterator(world_, ids_, nullptr, count_, count_, since_, exclude_);
+        }
+
+        // Calls fn(count, span_t<Cs>...) for every run.
+        template <typename F>
+        void each(F&& fn) const;
+
+        // Same as each(), on a thread pool. Tasks cover whole storage chunks when the view scans
+        // every entity, so runs are never split between tasks.
+        template <typename F>
+        void par_each(F&& fn, ThreadPool& pool = ThreadPool::shared()) const;
+
+    private:
+        World* world_;
+        const Index* ids_;
+        const MatchWord* bits_;
+        Index count_;
+        Tick since_;
+        TypeMask exclude_;
+        std::shared_ptr<std::vector<MatchWord>> keep_;
+#if ECS_TELEMETRY
+        mutable std::shared_ptr<telemetry::QueryProbe> probe_;
+#endif
+    };
+}
+
+namespace std {
+    template <typename... Cs>
+    struct tuple_size<amyinorbit::ecs::Chunk<Cs...>>
+        : std::integral_constant<std::size_t, sizeof...(Cs) + 1> {};
+
+    template <typename... Cs>
+    struct tuple_element<0, amyinorbit::ecs::Chunk<Cs...>> {
+        using type = amyinorbit::ecs::Index;
+    };
+
+    template <std::size_t N, typename... Cs>
+    struct tuple_element<N, amyinorbit::ecs::Chunk<Cs...>> {
+        using type = amyinorbit::ecs::span_t<amyinorbit::ecs::nth_type_t<N - 1, Cs...>>;
     };
 }
@@ -11,20 +11,245 @@ namespace amyinorbit::ecs {
 
     template <typename... Cs>
     auto EntityIterator<Cs...>::operator++() -> EntityIterator& {
-        index_++;
-        next();
+        if(!bits_) {
+            index_++;
+            next_id();
+            return *this;
+        }
+        // Fast path: the next match is in the current word.
+        if(word_) {
+            index_ = (index_ & ~Index(63)) + Index(__builtin_ctzll(word_));
+            word_ &= word_ - 1;
+            if(index_ < end_ && world_->template passes<Cs...>(index_, since_)) return *this;
+        }
+        next_bit();
         return *this;
     }
 
     template <typename... Cs>
     auto EntityIterator<Cs...>::operator*() const -> reference {
-        return reference(world_, world_->entity(index_));
+#if ECS_TELEMETRY
+        if(probe_) probe_->visit();
+#endif
+        return reference(world_, world_->entity(id()));
+    }
+
+    template <typename... Cs>
+    void EntityIterator<Cs...>::start() {
+        if(bits_) {
+            if(index_ == end_) return;
+            // Keep the bits from [index_] on, so that next_bit() lands on the first match.
+            word_ = bits_[index_ / 64] & (~MatchWord(0) << (index_ % 64));
+            index_ &= ~Index(63);
+            next_bit();
+        } else {
+            next_id();
+        }
     }
 
     template <typename... Cs>
-    void EntityIterator<Cs...>::next() {
-        while(!world_->has_components<Cs...>(index_) && index_ != MAX_COMPONENTS) {
+    void EntityIterator<Cs...>::next_bit() {
+        // Pops the lowest bit of the current word, moving to the next word when it runs out.
+        for(;;) {
+            while(!word_) {
+                index_ = (index_ & ~Index(63)) + 64;
+                if(index_ >= end_) {
+                    index_ = end_;
+                    return;
+                }
+                word_ = bits_[index_ / 64];
+            }
+            index_ = (index_ & ~Index(63)) + Index(__builtin_ctzll(word_));
+            word_ &= word_ - 1;
+            if(index_ >= end_) {
+                index_ = end_;
+                return;
+            }
+            if(world_->template passes<Cs...>(index_, since_)) return;
+        }
+    }
+
+    template <typename... Cs>
+    void EntityIterator<Cs...>::next_id() {
+        while(index_ != end_ && !world_->template matches<Cs...>(id(), since_, exclude_)) {
             index_ += 1;
         }
     }
+
+    template <typename... Cs>
+    template <typename F>
+    void EntityIterator<Cs...>::par_each(const EntityIterator& last,
+                                         ThreadPool& pool, F& fn) const {
+        auto world = world_;
+        auto ids = ids_;
+        auto bits = bits_;
+        auto since = since_;
+        auto exclude = exclude_;
+#if ECS_TELEMETRY
+        auto probe = probe_;
+#endif
+        // Ranges start on a chunk boundary, so each task stays within one storage chunk. The
+        // first one is clamped to where this iterator actually starts.
+        auto first = index_;
+        auto run = [=, &fn](Index from, Index to) {
+            from = std::max(from, first);
+            Index visited = 0;
+            if(bits) {
+                for(auto id = next_match(bits, from, to); id != to;
+                    id = next_match(bits, id + 1, to)) {
+                    if(!world->template passes<Cs...>(id, since)) continue;
+                    auto entity = world->entity(id);
+                    fn(world->template access<Cs>(entity)...);
+                    visited += 1;
+                }
+            } else {
+                for(Index i = from; i < to; ++i) {
+                    auto id = ids ? ids[i] : i;
+                    if(!world->template matches<Cs...>(id, since, exclude)) continue;
+                    auto entity = world->entity(id);
+                    fn(world->template access<Cs>(entity)...);
+                    visited += 1;
+                }
+            }
+#if ECS_TELEMETRY
+            if(probe) probe->visit_shared(visited);
+#endif
+            (void)visited;
+        };
+        auto aligned = index_ - index_ % ENTITIES_PER_CHUNK;
+        pool.parallel_for(aligned, last.index_, ENTITIES_PER_CHUNK, run);
+    }
+
+    template <typename... Cs>
+    auto View<EntityIterator<Cs...>>::begin() const -> iterator {
+#if ECS_TELEMETRY
+        if(!probe_) {
+            probe_ = std::make_shared<telemetry::QueryProbe>(telemetry::query_name<Cs...>());
+        }
+#endif
+        iterator it(world_, ids_, bits(), 0, count_, since_, exclude_);
+#if ECS_TELEMETRY
+        it.probe_ = probe_.get();
+#endif
+        return it;
+    }
+
+    template <typename... Cs>
+    const MatchWord* View<EntityIterator<Cs...>>::bits() const {
+        if(ids_) return nullptr;
+        if(!bits_) {
+            bits_ = std::make_shared<std::vector<MatchWord>>(match_words(count_));
+            world_->scan(type_mask_v<Cs...>, exclude_, count_, bits_->data());
+        }
+        return bits_->data();
+    }
+
+    template <typename... Cs>
+    View<ChunkIterator<Cs...>> View<EntityIterator<Cs...>>::chunks() const {
+        auto scan = bits();
+        return View<ChunkIterator<Cs...>>(world_, ids_, scan, count_, since_, exclude_, bits_);
+    }
+
+    template <typename... Cs>
+    auto View<ChunkIterator<Cs...>>::begin() const -> iterator {
+#if ECS_TELEMETRY
+        if(!probe_) {
+            probe_ = std::make_shared<telemetry::QueryProbe>(telemetry::query_name<Cs...>());
+        }
+#endif
+        iterator it(world_, ids_, bits_, 0, count_, since_, exclude_);
+#if ECS_TELEMETRY
+        it.probe_ = probe_.get();
+#endif
+        return it;
+    }
+
+    template <typename... Cs>
+    auto ChunkIterator<Cs...>::operator*() const -> reference {
+#if ECS_TELEMETRY
+        if(probe_) probe_->visit(count_);
+#endif
+        auto first = id();
+        return reference{first, count_, {world_->template access_span<Cs>(first, count_)...}};
+    }
+
+    template <typename... Cs>
+    bool ChunkIterator<Cs...>::accept(Index id) const {
+        // Ids from the scan already match the masks; candidate lists still need testing.
+        return ids_ ? world_->template matches<Cs...>(id, since_, exclude_)
+                    : world_->template passes<Cs...>(id, since_);
+    }
+
+    template <typename... Cs>
+    void ChunkIterator<Cs...>::find() {
+        count_ = 0;
+        if(bits_) {
+            index_ = next_match(bits_, index_, end_);
+            if constexpr(filtered) {
+                while(index_ != end_ && !accept(index_)) {
+                    index_ = next_match(bits_, index_ + 1, end_);
+                }
+            }
+        } else {
+            while(index_ != end_ && !accept(id())) index_ += 1;
+        }
+        if(index_ == end_) return;
+
+        // Extend the run up to the end of the first entity's chunk.
+        auto first = id();
+        auto limit = std::min<Index>(end_ - index_,
+            ENTITIES_PER_CHUNK - first % ENTITIES_PER_CHUNK);
+        if(bits_ && !filtered) {
+            count_ = next_miss(bits_, index_, index_ + limit) - index_;
+            return;
+        }
+        count_ = 1;
+        while(count_ < limit) {
+            auto next = index_ + count_;
+            if(bits_) {
+                if(!((bits_[next / 64] >> (next % 64)) & 1) || !accept(next)) break;
+            } else {
+                if(ids_[next] != first + count_ || !accept(ids_[next])) break;
+            }
+            count_ += 1;
+        }
+    }
+
+    template <typename... Cs>
+    template <typename F>
+    void View<ChunkIterator<Cs...>>::each(F&& fn) const {
+        for(auto it = begin(), last = end(); it != last; ++it) {
+            auto chunk = *it;
+            std::apply([&](const auto&... spans) { fn(chunk.count, spans...); }, chunk.spans);
+        }
+    }
+
+    template <typename... Cs>
+    template <typename F>
+    void View<ChunkIterator<Cs...>>::par_each(F&& fn, ThreadPool& pool) const {
+        auto world = world_;
+        auto ids = ids_;
+        auto bits = bits_;
+        auto since = since_;
+        auto exclude = exclude_;
+#if ECS_TELEMETRY
+        begin();
+        auto probe = probe_;
+#endif
+        auto run = [=, &fn](Index from, Index to) {
+            ChunkIterator<Cs...> it(world, ids, bits, from, to, since, exclude);
+            ChunkIterator<Cs...> last(world, ids, nullptr, to, to, since, exclude);
+            Index visited = 0;
+            for(; it != last; ++it) {
+                auto chunk = *it;
+                std::apply([&](const auto&... spans) { fn(chunk.count, spans...); }, chunk.spans);
+                visited += chunk.count;
+            }
+#if ECS_TELEMETRY
+            probe->visit_shared(visited);
+#endif
+            (void)visited;
+        };
+        pool.parallel_for(0, count_, ENTITIES_PER_CHUNK, run);
+    }
 }
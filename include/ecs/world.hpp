@@ -1,5 +1,5 @@
 //===--------------------------------------------------------------------------------------------===
-// World.hpp - Statically-sized Index-component manager
+// World.hpp - Chunked, growable entity-component manager
 //
 // Created by Amy Parent <amy@amyparent.com>
 // Copyright (c) 2019 Amy Parent
@@ -7,90 +7,126 @@
 // =^•.•^=
 //===--------------------------------------------------------------------------------------------===
 #pragma once
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <memory>
 #include <type_traits>
+#include <unordered_map>
 #include <ecs/entity.hpp>
+#include <ecs/memory.hpp>
 #include <ecs/meta.hpp>
+#include <ecs/prefab.hpp>
 #include <ecs/proxy.hpp>
+#include <ecs/query.hpp>
+#include <ecs/scan.hpp>
+#include <ecs/store.hpp>
 #include <ecs/view.hpp>
 
-#define MAX_ENTITIES 128
-#define MAX_COMPONENTS 16
-
 namespace amyinorbit::ecs {
-    using byte = std::uint8_t;
-    struct Store {
-        Store(std::size_t elt_size, std::size_t count);
-        Store(Store&& other);
-        Store& operator=(Store&& other);
-        Store(const Store&) = delete;
-        Store& operator=(const Store&) = delete;
-        virtual ~Store();
-
-        byte* ptr(Index index);
-        const byte* ptr(Index index) const;
-        virtual void destroy(Index index) = 0;
-        virtual TypeMask mask() const = 0;
-    private:
-        void reset() {
-            elt_size_ = 0;
-            count_ = 0;
-            data_ = nullptr;
-        }
-        std::size_t elt_size_ = 0;
-        std::size_t count_ = 0;
-        byte* data_ = nullptr;
-    };
+    class CommandBuffer;
+
+    class World {
+    public:
 
-    template <typename T>
-    struct TypedStore : Store {
-        TypedStore() : Store(sizeof(T), MAX_ENTITIES) {}
+        // Worlds allocate their storage from an arena they own, or from a caller-provided memory
+        // resource that must outlive the world. Either way, every store is cache-line aligned.
+        World() : World(ArenaOptions()) {}
+        explicit World(const ArenaOptions& options);
+        explicit World(std::pmr::memory_resource* resource);
+        ~World();
+        World(const World&) = delete;
+        World& operator=(const World&) = delete;
 
-        template <
-            typename... Args,
-            std::enable_if_t<!std::is_constructible_v<T, Args...>>* = nullptr
-        >
-        T& make(Index index, Args&&... args) {
-            return *(new (ptr(index)) T{std::forward<Args>(args)...});
-        }
+        Entity create();
+        void destroy(Entity entity);
 
-        template <
-            typename... Args,
-            std::enable_if_t<std::is_constructible_v<T, Args...>>* = nullptr
-        >
-        T& make(Index index, Args&&... args) {
-            return *(new (ptr(index)) T(std::forward<Args>(args)...));
+        // Creates [count] entities that each get a copy of every component in [prefab]. Ids are
+        // recycled from the free list first, then allocated in one contiguous block; masks, stores
+        // and cached queries are all updated in bulk.
+        template <typename... Ts>
+        std::vector<Entity> create_n(Index count, const Prefab<Ts...>& prefab) {
+            std::vector<Entity> entities(count);
+            allocate(entities.data(), count, prefab.mask());
+            (store<Ts>().fill(entities.data(), count, prefab.template get<Ts>(), tick_), ...);
+            return entities;
         }
 
-        virtual void destroy(Index index) { get(index).~T(); }
-        T& get(Index index) { return *ptr(index); }
-        const T& get(Index index) const { return *ptr(index); }
+        // Thread-safe: reserves an entity id (recycled from the free list when possible) that
+        // becomes live at the next flush().
+        Entity reserve();
 
-        T* ptr(Index index) { return reinterpret_cast<T*>(Store::ptr(index)); }
-        const T* ptr(Index index) const { return reinterpret_cast<const T*>(Store::ptr(index)); }
+        // Returns the calling thread's command buffer for this world.
+        CommandBuffer& commands();
 
-        TypeMask mask() const { return type_mask<T>(); }
-    private:
-    };
+        // Sync point: makes reserved entities live, then applies every thread's recorded
+        // commands, in the order the buffers were first requested. Must not run concurrently
+        // with anything else touching the world.
+        void flush();
 
-    class World {
-    public:
+        std::pmr::memory_resource* resource() const { return resource_; }
 
-        World();
+        Entity entity(Index idx) const { return Entity{idx, versions_[idx]}; }
+        Index size() const { return next_index_; }
+
+        // Binary snapshots of every entity and component. Restoring replaces the whole world, and
+        // needs the stores of all snapshotted components to exist already (see prepare()). Raw
+        // components are copied straight back into chunk memory; restore_file() maps the file
+        // instead of reading it. Pending command buffers are discarded by a restore.
+        std::vector<byte> snapshot() const;
+        void restore(const byte* data, std::size_t size);
+        void restore(const std::vector<byte>& data) { restore(data.data(), data.size()); }
+        void save_file(const std::string& path) const;
+        void restore_file(const std::string& path);
+
+        // Creates the stores for Ts up front. Stores are otherwise created lazily, which is not
+        // safe once several threads access the world.
+        template <typename... Ts>
+        void prepare() { (store<Ts>(), ...); }
 
-        Entity create();
-        void destroy(Entity entity);
+        // Direct access to the store backing T, e.g. for the per-field arrays of an SoAStore.
+        // Bypasses change tracking.
+        template <typename T>
+        storage_t<T>& storage() { return store<T>(); }
 
-        Entity entity(Index idx) const { return Entity{idx, versions_[idx]}; }
+        // Change tracking: every write through add_component, set_component or non-const access
+        // stamps the component with the current tick. advance() starts a new tick, usually once
+        // per frame.
+        Tick tick() const { return tick_; }
+        Tick advance() { return ++tick_; }
+
+        template <typename T>
+        bool changed_since(Entity entity, Tick since) const {
+            assert(has_component<T>(entity));
+            return store<T>().changed(entity.id) >= since;
+        }
 
         template <typename T, typename... Args>
-        T& add_component(Entity entity, Args&&... args) {
+        component_ref_t<T> add_component(Entity entity, Args&&... args) {
+            assert(is_valid(entity));
+            auto old = masks_[entity.id];
+            masks_[entity.id] |= type_mask_v<T>;
+            auto& s = store<T>();
+            decltype(auto) component = s.make(entity.id, std::forward<Args>(args)...);
+            s.mark(entity.id, tick_);
+            update_queries(entity.id, old);
+            return component;
+        }
+
+        template <typename T>
+        void remove_component(Entity entity) {
             assert(is_valid(entity));
-            masks_[entity.id] |= type_mask<T>();
-            return store<T>().make(entity.id, std::forward<Args>(args)...);
+            assert(has_component<T>(entity));
+            store<T>().destroy(entity.id);
+            removals_[component_id<T>()] += 1;
+            auto old = masks_[entity.id];
+            masks_[entity.id].reset(component_id<T>());
+            update_queries(entity.id, old);
         }
 
         template <typename T>
@@ -98,94 +134,249 @@ namespace amyinorbit::ecs {
             assert(is_valid(entity));
             assert(has_component<T>(entity));
             store<T>().get(entity.id) = component;
+            store<T>().mark(entity.id, tick_);
         }
 
-        template <typename T>
+        template <typename T, std::enable_if_t<!std::is_reference_v<T>>* = nullptr>
         void set_component(Entity entity, T&& component) {
             assert(is_valid(entity));
             assert(has_component<T>(entity));
             store<T>().get(entity.id) = std::move(component);
+            store<T>().mark(entity.id, tick_);
         }
 
         template <typename T>
-        T& get_component(Entity entity) {
+        component_ref_t<T> get_component(Entity entity) {
             assert(is_valid(entity));
             assert(has_component<T>(entity));
+            store<T>().mark(entity.id, tick_);
             return store<T>().get(entity.id);
         }
 
         template <typename T>
-        const T& get_component(Entity entity) const {
+        component_cref_t<T> get_component(Entity entity) const {
             assert(is_valid(entity));
             assert(has_component<T>(entity));
             return store<T>().get(entity.id);
         }
 
         template <typename T>
-        T& get_component_unchk(Entity entity) { return store<T>().get(entity.id); }
+        component_ref_t<T> get_component_unchk(Entity entity) { return store<T>().get(entity.id); }
 
         template <typename T>
-        const T& get_component_unchk(Entity entity) const { return store<T>().get(entity.id); }
+        component_cref_t<T> get_component_unchk(Entity entity) const {
+            return store<T>().get(entity.id);
+        }
+
+        // Query-side access to the component named by query term Q (C, const C or Changed<C>).
+        template <typename Q>
+        query_ref_t<Q> access(Entity entity) {
+            auto& s = store<component_t<Q>>();
+            if constexpr(!query_traits<Q>::read_only) s.mark(entity.id, tick_);
+            return s.get(entity.id);
+        }
+
+        template <typename Q>
+        component_cref_t<component_t<Q>> read(Entity entity) const {
+            return store<component_t<Q>>().get(entity.id);
+        }
+
+        // Chunk-query access to the components named by Q for the [count] consecutive ids from
+        // [first], which must all be in one storage chunk.
+        template <typename Q>
+        span_t<Q> access_span(Index first, Index count) {
+            using C = component_t<Q>;
+            static_assert(!is_sparse_v<C> && !is_tag_v<C>,
+                          "chunk queries need id-indexed storage: iterate tags and sparse "
+                          "components per entity");
+            auto& s = store<C>();
+            if constexpr(!query_traits<Q>::read_only) s.mark(first, count, tick_);
+            return s.span(first);
+        }
+
+        // Whether entity [id] has every component in Qs and none in [exclude], and every
+        // Changed<C> term changed at or after [since].
+        template <typename... Qs>
+        bool matches(Index id, Tick since, const TypeMask& exclude = TypeMask()) const {
+            return has_components<Qs...>(id) && !masks_[id].intersects(exclude)
+                && passes<Qs...>(id, since);
+        }
+
+        // Just the Changed<C> part of matches(), for ids whose mask is already known to match.
+        template <typename... Qs>
+        bool passes(Index id, Tick since) const {
+            return (changed_filter<Qs>(id, since) && ...);
+        }
+
+        // Writes the match bits of the first [count] entities against [include] and [exclude]
+        // (see scan_masks()).
+        void scan(const TypeMask& include, const TypeMask& exclude, Index count,
+                  MatchWord* bits, ScanIsa isa = scan_isa()) const {
+            assert(count <= next_index_);
+            scan_masks(masks_.data(), count, include, exclude, bits, isa);
+        }
 
         template <typename T>
         bool has_component(Entity entity) const {
-            return (masks_[entity.id] & type_mask<T>()) != 0;
+            return masks_[entity.id].test(component_id<T>());
         }
 
         template <typename... Ts>
         bool has_components(Entity entity) const {
-            auto mask = type_mask<Ts...>();
-            return (mask & masks_[entity.id]) == mask;
+            return masks_[entity.id].contains(type_mask_v<Ts...>);
         }
 
         template <typename... Ts>
         bool has_components(Index id) const {
-            auto mask = type_mask<Ts...>();
-            return (mask & masks_[id]) == mask;
+            return masks_[id].contains(type_mask_v<Ts...>);
         }
 
         bool is_valid(Entity entity) const {
             return versions_[entity.id] == entity.version;
         }
 
+        // Entities that have every component in Ts. Chain without<Xs...>() to also skip the
+        // entities that have any of Xs:
+        //
+        //     for(auto [glider]: world.with<Glider>().without<Circling>()) { ... }
+        //
+        // Matching only reads entity masks, with SIMD when the CPU has it.
+        template <typename... Ts>
+        View<EntityIterator<Ts...>> with() { return with<Ts...>(tick_); }
+
+        // Changed<C> terms in Ts only match components written at or after [since].
+        template <typename... Ts>
+        View<EntityIterator<Ts...>> with(Tick since) {
+            const Index* ids = nullptr;
+            Index count = next_index_;
+            (select_driver<component_t<Ts>>(ids, count), ...);
+            return View<EntityIterator<Ts...>>(this, ids, count, since);
+        }
+
+        // Like with(), but iterates a persistent list of the entities that have every component in
+        // Ts. The list is cached by component mask and kept up to date as masks change, so a
+        // query costs O(matches) once it exists. Adding or removing components of the iterated
+        // entities inside the loop invalidates it: defer those through commands().
+        template <typename... Ts>
+        View<EntityIterator<Ts...>> query() { return query<Ts...>(tick_); }
+
         template <typename... Ts>
-        View<EntityIterator<Ts...>> with() {
-        using MyIterator = EntityIterator<Ts...>;
-            using MyView = View<MyIterator>;
-            return MyView{
-                MyIterator(this, 0),
-                MyIterator(this, MAX_COMPONENTS)
-            };
+        View<EntityIterator<Ts...>> query(Tick since) {
+            static_assert(sizeof...(Ts) > 0, "queries need at least one component");
+            const auto& cached = cached_query(type_mask_v<Ts...>);
+            return View<EntityIterator<Ts...>>(this, cached.data(), cached.size(), since);
         }
 
+        // Number of entities that have every component in Ts, from the query cache.
+        template <typename... Ts>
+        Index count() { return cached_query(type_mask_v<Ts...>).size(); }
+
+        // Number of times an entity has lost a T, through remove_component(), destroy() or
+        // restore(). Lets structures built from T (see SpatialIndex) tell when to look for leavers.
+        template <typename T>
+        std::uint64_t removals() const { return removals_[component_id<T>()]; }
+
+        QueryStats query_stats() const;
+
+        // Occupancy of every store that exists, in component id order. Live counts come from the
+        // entity masks, so this is O(entities): meant for diagnostics, not for every frame.
+        std::vector<StoreStats> store_stats() const;
+
     private:
 
+        // Finds or builds the cached query for [mask]. Safe to call from several threads.
+        const Query& cached_query(const TypeMask& mask);
+
+        void update_queries(Index id, const TypeMask& old) {
+            for(auto query: query_list_) query->update(id, old, masks_[id]);
+        }
+
+        // Rebuilds every cached query from the entity masks.
+        void rebuild_queries();
+
+        template <typename Q>
+        bool changed_filter(Index id, Tick since) const {
+            if constexpr(query_traits<Q>::changed) {
+                static_assert(!is_tag_v<component_t<Q>>, "tags do not track changes");
+                return store<component_t<Q>>().changed(id) >= since;
+            } else {
+                return true;
+            }
+        }
+
+        // Queries that include sparse components are driven from the smallest sparse pool instead
+        // of scanning every entity id.
+        template <typename T>
+        void select_driver(const Index*& ids, Index& count) {
+            if constexpr(is_sparse_v<T>) {
+                auto& pool = store<T>();
+                if(!ids || pool.size() < count) {
+                    ids = pool.owners();
+                    count = pool.size();
+                }
+            }
+        }
+
         template <typename T>
-        TypedStore<T>& store() {
-            auto idx = component_id<T>();
+        storage_t<T>& store() {
+            constexpr auto idx = component_id<T>();
+            assert(!stores_[idx] || stores_[idx]->key() == &type_key<T>);
             return stores_[idx] ?
-                *reinterpret_cast<TypedStore<T>*>(stores_[idx].get()) :
+                *static_cast<storage_t<T>*>(stores_[idx].get()) :
                 create_store<T>();
         }
 
         template <typename T>
-        TypedStore<T>& create_store() {
+        const storage_t<T>& store() const {
+            constexpr auto idx = component_id<T>();
+            assert(stores_[idx] && stores_[idx]->key() == &type_key<T>);
+            return *static_cast<const storage_t<T>*>(stores_[idx].get());
+        }
+
+        template <typename T>
+        storage_t<T>& create_store() {
             auto id = component_id<T>();
-            auto ptr = new TypedStore<T>();
+            auto ptr = new storage_t<T>(resource_);
             stores_[id].reset(ptr);
             return *ptr;
         }
 
+        // Makes [count] new entities live with [mask], writing them to [out]. Their components
+        // must be constructed by the caller before anything reads them.
+        void allocate(Entity* out, Index count, const TypeMask& mask);
+
+        // Makes reserved ids live and drops the free-list entries that reserve() handed out.
+        void materialize();
+
+        // Declared first so that it outlives every store allocated from it.
+        std::unique_ptr<ArenaResource> arena_;
+        std::pmr::memory_resource* resource_;
+
         std::unique_ptr<Store> stores_[MAX_COMPONENTS];
+        std::uint64_t removals_[MAX_COMPONENTS] = {};
 
         Index next_index_ = 0;
+        std::atomic<Index> reserved_{0};
+        Tick tick_ = 1;
+
+        aligned_vector<TypeMask> masks_;
+        aligned_vector<Index> versions_;
+
+        aligned_vector<Index> free_list_;
+        std::atomic<std::int64_t> free_cursor_{0};
 
-        TypeMask masks_[MAX_ENTITIES];
-        Index versions_[MAX_ENTITIES];
+        mutable std::mutex queries_lock_;
+        std::unordered_map<TypeMask, std::unique_ptr<Query>> queries_;
+        std::vector<Query*> query_list_;
+        std::size_t query_hits_ = 0;
+        std::size_t query_misses_ = 0;
 
-        std::vector<Index> free_list_;
+        const std::uint64_t serial_;
+        std::mutex commands_lock_;
+        std::vector<std::pair<std::thread::id, std::unique_ptr<CommandBuffer>>> command_buffers_;
     };
 }
 
 #include "proxy.inl"
 #include "view.inl"
+#include "commands.hpp"
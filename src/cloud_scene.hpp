@@ -8,11 +8,16 @@
 //===--------------------------------------------------------------------------------------------===
 #pragma once
 #include <ecs/world.hpp>
+#include <ecs/system.hpp>
 #include "engine/scene3d.hpp"
+#include "engine/hierarchy.hpp"
 #include "engine/model_renderer.hpp"
 #include "engine/raymarcher.hpp"
+#include "engine/simulation.hpp"
+#include "engine/telemetry_panel.hpp"
 #include "color.hpp"
 #include "imgui/imgui.h"
+#include <memory>
 
 namespace amyinorbit {
     using ecs::Entity;
@@ -31,7 +36,8 @@ namespace amyinorbit {
         CloudScene(App& app, AssetsLib& assets)
         : Scene3D(app, assets)
         , clouds(assets)
-        , models(assets, ecs) {
+        , models(assets) {
+            systems.add<TransformHierarchy>();
             camera().fov = 60.f;
             camera().position = vec3(40);
             camera().target = vec3(0);
@@ -42,15 +48,28 @@ namespace amyinorbit {
             {
                 ground = ecs.create();
                 auto& m = ecs.add_component<Model>(ground, models.model("plane.obj"));
-                m.texture = assets.texture("tex.png");
+                m.texture = models.texture(assets.texture("tex.png"));
                 m.texture_blend = 1.f;
-                auto& t = ecs.add_component<Transform>(ground);
+                auto t = ecs.add_component<Transform>(ground);
                 t.set_scale(world.size);
             }
             set_effects(assets.shader("clouds.vert", "clouds.frag"));
+
+            // From here on the world belongs to the simulation thread. Rendering reads the last
+            // frame it published, so a slow frame on either side never stalls the other.
+            state.publish(ecs);
+            simulation = std::make_unique<Simulation>(sim_rate, [this](float dt) {
+                systems.run(ecs, dt);
+                state.publish(ecs);
+            });
         }
 
         ~CloudScene() {
+            simulation->stop();
+#if ECS_TELEMETRY
+            telemetry.update();
+            telemetry.dump_csv("telemetry.csv");
+#endif
             ecs.destroy(ground);
         }
 
@@ -63,13 +82,17 @@ namespace amyinorbit {
             ImGui::SliderFloat("wind speed", &wind_speed, 0.f, 5.f, "%.2f");
             camera().position = cartesian(elevation, azimuth, distance);
             ImGui::End();
+#if ECS_TELEMETRY
+            telemetry_panel(telemetry);
+#endif
         }
 
         void update(App& app) override {
+            state.acquire();
         }
 
         void render_scene(App& app, const RenderData& rd) override {
-            models.render(rd);
+            models.render(rd, state.front());
         }
 
         void prepare_effects(const RenderData& data, Shader& shader) override {
@@ -78,8 +101,10 @@ namespace amyinorbit {
         }
     private:
         World ecs;
+        ecs::Scheduler systems;
         RayMarcher clouds;
         ModelRenderer models;
+        RenderState state;
 
         Entity ground;
 
@@ -90,5 +115,12 @@ namespace amyinorbit {
         struct {
             vec3 size{10, 10, 10};
         } world;
+
+#if ECS_TELEMETRY
+        ecs::telemetry::Monitor telemetry;
+#endif
+
+        static constexpr double sim_rate = 60.0;
+        std::unique_ptr<Simulation> simulation;
     };
 }
@@ -0,0 +1,166 @@
+//===--------------------------------------------------------------------------------------------===
+// archetype.cpp - Archetype component storage
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/archetype.hpp>
+#include <algorithm>
+
+namespace amyinorbit::ecs {
+
+    // MARK: - Column
+
+    Column::Column(Column&& other)
+        : info_(other.info_), data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+        other.data_ = nullptr;
+        other.size_ = other.capacity_ = 0;
+    }
+
+    Column& Column::operator=(Column&& other) {
+        if(&other != this) {
+            clear();
+            ::operator delete(data_, std::align_val_t(info_->align));
+            info_ = other.info_;
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.data_ = nullptr;
+            other.size_ = other.capacity_ = 0;
+        }
+        return *this;
+    }
+
+    Column::~Column() {
+        clear();
+        ::operator delete(data_, std::align_val_t(info_->align));
+    }
+
+    void* Column::push() {
+        if(size_ == capacity_) grow();
+        return at(size_++);
+    }
+
+    void Column::fill_hole(Index row) {
+        assert(row < size_);
+        auto last = size_ - 1;
+        if(row != last) info_->relocate(at(row), at(last));
+        size_ = last;
+    }
+
+    void Column::clear() {
+        for(Index row = 0; row < size_; ++row) {
+            info_->destroy(at(row));
+        }
+        size_ = 0;
+    }
+
+    void Column::grow() {
+        Index capacity = capacity_ ? capacity_ * 2 : 64;
+        auto data = static_cast<std::uint8_t*>(
+            ::operator new(capacity * info_->size, std::align_val_t(info_->align)));
+        for(Index row = 0; row < size_; ++row) {
+            info_->relocate(data + row * info_->size, at(row));
+        }
+        ::operator delete(data_, std::align_val_t(info_->align));
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    // MARK: - Archetype
+
+    Archetype::Archetype(TypeMask mask, const ComponentInfo* const* infos) : mask(mask) {
+        std::fill(std::begin(column_index), std::end(column_index), -1);
+        mask.each([&](std::size_t id) {
+            assert(infos[id]);
+            column_index[id] = std::int16_t(columns.size());
+            columns.emplace_back(*infos[id]);
+        });
+    }
+
+    // MARK: - World
+
+    ArchetypeWorld::ArchetypeWorld() {
+        find_or_create(TypeMask());
+    }
+
+    ArchetypeWorld::~ArchetypeWorld() {}
+
+    Entity ArchetypeWorld::create() {
+        Index id;
+        if(free_list_.size()) {
+            id = free_list_.back();
+            free_list_.pop_back();
+        } else {
+            id = Index(records_.size());
+            records_.push_back(Record{TypeMask(), 0, 0});
+            versions_.push_back(1);
+        }
+
+        auto& empty = *archetypes_[0];
+        Entity entity{id, versions_[id]};
+        records_[id] = Record{TypeMask(), 0, empty.size()};
+        empty.entities.push_back(entity);
+        return entity;
+    }
+
+    void ArchetypeWorld::destroy(Entity entity) {
+        assert(is_valid(entity));
+        auto& rec = records_[entity.id];
+        auto& arch = *archetypes_[rec.archetype];
+        for(auto& col: arch.columns) {
+            col.info().destroy(col.at(rec.row));
+        }
+        remove_row(arch, rec.row);
+
+        rec = Record{TypeMask(), 0, 0};
+        versions_[entity.id] += 1;
+        free_list_.push_back(entity.id);
+    }
+
+    Index ArchetypeWorld::find_or_create(TypeMask mask) {
+        auto it = lookup_.find(mask);
+        if(it != lookup_.end()) return it->second;
+
+        auto index = Index(archetypes_.size());
+        archetypes_.emplace_back(new Archetype(mask, infos_));
+        lookup_[mask] = index;
+        return index;
+    }
+
+    Index ArchetypeWorld::move_entity(Entity entity, Index target) {
+        auto& rec = records_[entity.id];
+        auto& src = *archetypes_[rec.archetype];
+        auto& dst = *archetypes_[target];
+
+        auto row = dst.size();
+        dst.entities.push_back(entity);
+        for(auto& col: src.columns) {
+            auto id = col.info().id;
+            if(dst.has(id)) {
+                col.info().relocate(dst.column(id).push(), col.at(rec.row));
+            } else {
+                col.info().destroy(col.at(rec.row));
+            }
+        }
+        remove_row(src, rec.row);
+
+        rec = Record{dst.mask, target, row};
+        return row;
+    }
+
+    void ArchetypeWorld::remove_row(Archetype& arch, Index row) {
+        for(auto& col: arch.columns) {
+            col.fill_hole(row);
+        }
+        auto last = arch.size() - 1;
+        if(row != last) {
+            auto moved = arch.entities[last];
+            arch.entities[row] = moved;
+            records_[moved.id].row = row;
+        }
+        arch.entities.pop_back();
+    }
+}
@@ -0,0 +1,51 @@
+//===--------------------------------------------------------------------------------------------===
+// commands.cpp - Deferred structural changes to a world
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/commands.hpp>
+
+namespace amyinorbit::ecs {
+
+    void CommandBuffer::apply() {
+        for(auto& command: commands_) {
+            command.run(world_, command.entity, command.payload);
+            if(command.drop) command.drop(command.payload);
+            command.drop = nullptr;
+        }
+        clear();
+    }
+
+    void CommandBuffer::clear() {
+        for(auto& command: commands_) {
+            if(command.drop) command.drop(command.payload);
+        }
+        commands_.clear();
+        oversized_.clear();
+        block_ = 0;
+        used_ = 0;
+    }
+
+    void* CommandBuffer::allocate(std::size_t size) {
+        constexpr auto align = alignof(std::max_align_t);
+        size = (size + align - 1) & ~(align - 1);
+        if(size > block_size) {
+            oversized_.emplace_back(new byte[size]);
+            return oversized_.back().get();
+        }
+
+        if(block_ < blocks_.size() && used_ + size > block_size) {
+            block_ += 1;
+            used_ = 0;
+        }
+        if(block_ == blocks_.size()) {
+            blocks_.emplace_back(new byte[block_size]);
+        }
+        void* ptr = blocks_[block_].get() + used_;
+        used_ += size;
+        return ptr;
+    }
+}
@@ -0,0 +1,136 @@
+//===--------------------------------------------------------------------------------------------===
+// memory.cpp - Arena and cache-aligned allocation for world storage
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/memory.hpp>
+#include <algorithm>
+#include <new>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+namespace amyinorbit::ecs {
+
+    namespace {
+        std::size_t align_up(std::size_t value, std::size_t align) {
+            return (value + align - 1) & ~(align - 1);
+        }
+
+        // Requests are rounded up to a power of two, at least a cache line. Growing vectors ask
+        // for ever-changing sizes, so exact-size free lists would almost never be hit again.
+        std::size_t size_class(std::size_t bytes) {
+            std::size_t size = CACHE_LINE_SIZE;
+            while(size < bytes) size <<= 1;
+            return size;
+        }
+    }
+
+    ArenaResource::ArenaResource(const ArenaOptions& options) : options_(options) {
+        options_.block_size = align_up(std::max<std::size_t>(options_.block_size, 4096), 4096);
+    }
+
+    ArenaResource::~ArenaResource() {
+        release();
+    }
+
+    void ArenaResource::release() {
+        for(const auto& block: blocks_) {
+#if defined(__linux__) || defined(__APPLE__)
+            if(block.mapped) {
+                ::munmap(block.data, block.size);
+                continue;
+            }
+#endif
+            ::operator delete(block.data, std::align_val_t(CACHE_LINE_SIZE));
+        }
+        blocks_.clear();
+        free_lists_.clear();
+        largest_free_ = 0;
+        cursor_ = end_ = nullptr;
+        reserved_ = used_ = 0;
+    }
+
+    ArenaResource::Block ArenaResource::allocate_block(std::size_t size) {
+#if defined(__linux__) || defined(__APPLE__)
+        if(options_.huge_pages) {
+            auto ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(ptr == MAP_FAILED) throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+            ::madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+            return Block{static_cast<std::uint8_t*>(ptr), size, true};
+        }
+#endif
+        auto ptr = ::operator new(size, std::align_val_t(CACHE_LINE_SIZE));
+        return Block{static_cast<std::uint8_t*>(ptr), size, false};
+    }
+
+    void* ArenaResource::do_allocate(std::size_t bytes, std::size_t align) {
+        align = std::max<std::size_t>(align, CACHE_LINE_SIZE);
+        bytes = size_class(bytes);
+
+        if(align == CACHE_LINE_SIZE) {
+            // The smallest free buffer that fits. A larger one is split in halves, and the halves
+            // that are not needed go back on their own lists: this is how the buffers that a
+            // growing vector leaves behind end up holding store chunks.
+            for(auto size = bytes; size <= largest_free_; size <<= 1) {
+                auto it = free_lists_.find(size);
+                if(it == free_lists_.end() || !it->second) continue;
+                auto node = it->second;
+                it->second = node->next;
+                while(size > bytes) {
+                    size >>= 1;
+                    push_free(reinterpret_cast<std::uint8_t*>(node) + size, size);
+                }
+                used_ += bytes;
+                return node;
+            }
+        }
+
+        if(bytes + align > options_.block_size) {
+            // Oversized requests get a block of their own, so the current block keeps going.
+            auto size = align_up(bytes + align, 4096);
+            auto block = allocate_block(size);
+            blocks_.push_back(block);
+            reserved_ += size;
+            used_ += bytes;
+            return reinterpret_cast<std::uint8_t*>(
+                align_up(reinterpret_cast<std::uintptr_t>(block.data), align));
+        }
+
+        auto start = cursor_ ? reinterpret_cast<std::uint8_t*>(
+            align_up(reinterpret_cast<std::uintptr_t>(cursor_), align)) : nullptr;
+        if(!start || start + bytes > end_) {
+            auto block = allocate_block(options_.block_size);
+            blocks_.push_back(block);
+            reserved_ += block.size;
+            end_ = block.data + block.size;
+            start = reinterpret_cast<std::uint8_t*>(
+                align_up(reinterpret_cast<std::uintptr_t>(block.data), align));
+        }
+        cursor_ = start + bytes;
+        used_ += bytes;
+        return start;
+    }
+
+    void ArenaResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t align) {
+        align = std::max<std::size_t>(align, CACHE_LINE_SIZE);
+        bytes = size_class(bytes);
+        used_ -= bytes;
+        if(align != CACHE_LINE_SIZE) return; // over-aligned memory is only reclaimed in bulk
+        push_free(ptr, bytes);
+    }
+
+    void ArenaResource::push_free(void* ptr, std::size_t size) {
+        auto node = static_cast<FreeNode*>(ptr);
+        auto& head = free_lists_[size];
+        node->next = head;
+        head = node;
+        largest_free_ = std::max(largest_free_, size);
+    }
+}
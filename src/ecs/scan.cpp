@@ -0,0 +1,171 @@
+//===--------------------------------------------------------------------------------------------===
+// scan.cpp - Vectorised component mask scanning
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/scan.hpp>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ECS_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace amyinorbit::ecs {
+
+    namespace {
+        // A mask matches when ((mask & include) ^ include) | (mask & exclude) is all zeroes.
+        bool match(const TypeMask& mask, const TypeMask& include, const TypeMask& exclude) {
+            MatchWord acc = 0;
+            for(std::size_t i = 0; i < TypeMask::words; ++i) {
+                auto word = mask.word(i);
+                acc |= ((word & include.word(i)) ^ include.word(i)) | (word & exclude.word(i));
+            }
+            return acc == 0;
+        }
+
+        MatchWord scan_word(const TypeMask* masks, Index count, const TypeMask& include,
+                            const TypeMask& exclude) {
+            MatchWord out = 0;
+            for(Index i = 0; i < count; ++i) {
+                out |= MatchWord(match(masks[i], include, exclude)) << i;
+            }
+            return out;
+        }
+
+        void scan_scalar(const TypeMask* masks, Index count, const TypeMask& include,
+                         const TypeMask& exclude, MatchWord* bits) {
+            for(Index w = 0; w < match_words(count); ++w) {
+                auto n = std::min<Index>(64, count - w * 64);
+                bits[w] = scan_word(masks + w * 64, n, include, exclude);
+            }
+        }
+
+#if ECS_SCAN_X86
+        // The vector paths assume one mask fills exactly one 128-bit lane.
+        constexpr bool vector_masks = sizeof(TypeMask) == 16 && TypeMask::words == 2;
+
+        // The vector loops collect several movemask bits per mask, then fold each group into a
+        // single match bit and pack those together. [x] holds 32 pairs of bits.
+        MatchWord compact_pairs(MatchWord x) {
+            x &= (x >> 1) & 0x5555555555555555ull;
+            x = (x | (x >> 1)) & 0x3333333333333333ull;
+            x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0full;
+            x = (x | (x >> 4)) & 0x00ff00ff00ff00ffull;
+            x = (x | (x >> 8)) & 0x0000ffff0000ffffull;
+            return (x | (x >> 16)) & 0x00000000ffffffffull;
+        }
+
+        // [x] holds 16 nibbles.
+        MatchWord compact_nibbles(MatchWord x) {
+            x &= (x >> 1) & (x >> 2) & (x >> 3) & 0x1111111111111111ull;
+            x = (x | (x >> 3)) & 0x0303030303030303ull;
+            x = (x | (x >> 6)) & 0x000f000f000f000full;
+            x = (x | (x >> 12)) & 0x000000ff000000ffull;
+            return (x | (x >> 24)) & 0x000000000000ffffull;
+        }
+
+        // One mask per 128-bit register: four movemask bits per mask, 16 masks per fold.
+        __attribute__((target("sse2")))
+        void scan_sse2(const TypeMask* masks, Index count, const TypeMask& include,
+                       const TypeMask& exclude, MatchWord* bits) {
+            const auto inc = _mm_load_si128(reinterpret_cast<const __m128i*>(&include));
+            const auto exc = _mm_load_si128(reinterpret_cast<const __m128i*>(&exclude));
+            const auto zero = _mm_setzero_si128();
+            const Index full = count / 64;
+
+            for(Index w = 0; w < full; ++w) {
+                auto src = reinterpret_cast<const __m128i*>(masks + w * 64);
+                MatchWord out = 0;
+                for(Index group = 0; group < 4; ++group) {
+                    MatchWord acc = 0;
+                    for(Index i = 0; i < 16; ++i) {
+                        auto m = _mm_load_si128(src + group * 16 + i);
+                        auto miss = _mm_or_si128(_mm_xor_si128(_mm_and_si128(m, inc), inc),
+                                                 _mm_and_si128(m, exc));
+                        auto hit = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(miss, zero)));
+                        acc |= MatchWord(hit) << (4 * i);
+                    }
+                    out |= compact_nibbles(acc) << (16 * group);
+                }
+                bits[w] = out;
+            }
+            if(full * 64 < count) {
+                bits[full] = scan_word(masks + full * 64, count - full * 64, include, exclude);
+            }
+        }
+
+        // Two masks per 256-bit register: two movemask bits per mask, 32 masks per fold.
+        __attribute__((target("avx2")))
+        void scan_avx2(const TypeMask* masks, Index count, const TypeMask& include,
+                       const TypeMask& exclude, MatchWord* bits) {
+            const auto inc = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i*>(&include)));
+            const auto exc = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i*>(&exclude)));
+            const auto zero = _mm256_setzero_si256();
+            const Index full = count / 64;
+
+            for(Index w = 0; w < full; ++w) {
+                auto src = reinterpret_cast<const __m256i*>(masks + w * 64);
+                MatchWord out = 0;
+                for(Index group = 0; group < 2; ++group) {
+                    MatchWord acc = 0;
+                    for(Index i = 0; i < 16; ++i) {
+                        auto m = _mm256_load_si256(src + group * 16 + i);
+                        auto miss = _mm256_or_si256(
+                            _mm256_xor_si256(_mm256_and_si256(m, inc), inc),
+                            _mm256_and_si256(m, exc));
+                        auto hit = _mm256_movemask_pd(
+                            _mm256_castsi256_pd(_mm256_cmpeq_epi64(miss, zero)));
+                        acc |= MatchWord(hit) << (4 * i);
+                    }
+                    out |= compact_pairs(acc) << (32 * group);
+                }
+                bits[w] = out;
+            }
+            if(full * 64 < count) {
+                bits[full] = scan_word(masks + full * 64, count - full * 64, include, exclude);
+            }
+        }
+#endif
+    }
+
+    ScanIsa scan_isa() {
+#if ECS_SCAN_X86
+        static const ScanIsa best = [] {
+            if(!vector_masks) return ScanIsa::scalar;
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx2")) return ScanIsa::avx2;
+            if(__builtin_cpu_supports("sse2")) return ScanIsa::sse2;
+            return ScanIsa::scalar;
+        }();
+        return best;
+#else
+        return ScanIsa::scalar;
+#endif
+    }
+
+    const char* scan_isa_name(ScanIsa isa) {
+        switch(isa) {
+        case ScanIsa::scalar: return "scalar";
+        case ScanIsa::sse2: return "sse2";
+        case ScanIsa::avx2: return "avx2";
+        }
+        return "unknown";
+    }
+
+    void scan_masks(const TypeMask* masks, Index count, const TypeMask& include,
+                    const TypeMask& exclude, MatchWord* bits, ScanIsa isa) {
+#if ECS_SCAN_X86
+        if constexpr(vector_masks) {
+            if(isa == ScanIsa::avx2) return scan_avx2(masks, count, include, exclude, bits);
+            if(isa == ScanIsa::sse2) return scan_sse2(masks, count, include, exclude, bits);
+        }
+#endif
+        scan_scalar(masks, count, include, exclude, bits);
+    }
+}
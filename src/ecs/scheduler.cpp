@@ -0,0 +1,68 @@
+//===--------------------------------------------------------------------------------------------===
+// scheduler.cpp - Parallel system scheduler
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/system.hpp>
+
+namespace amyinorbit::ecs {
+
+    void Scheduler::build() {
+        nodes_.reset(new Node[systems_.size()]);
+        for(std::size_t j = 0; j < systems_.size(); ++j) {
+            for(std::size_t i = 0; i < j; ++i) {
+                if(!systems_[i]->conflicts(*systems_[j])) continue;
+                nodes_[i].dependents.push_back(j);
+                nodes_[j].dependencies += 1;
+            }
+        }
+    }
+
+    void Scheduler::run(World& world, float dt) {
+        if(systems_.empty()) return;
+#if ECS_TELEMETRY
+        telemetry::next_frame();
+        telemetry::Scope scope(telemetry::Kind::frame, "frame");
+        frame_ = &scope;
+#endif
+
+        // Stores are created lazily, so make sure every accessed store exists before systems
+        // start touching the world from several threads.
+        for(const auto& system: systems_) {
+            system->prepare(world);
+        }
+
+        world.advance();
+        build();
+        remaining_.store(systems_.size());
+        for(std::size_t i = 0; i < systems_.size(); ++i) {
+            nodes_[i].waiting.store(nodes_[i].dependencies);
+        }
+        for(std::size_t i = 0; i < systems_.size(); ++i) {
+            if(nodes_[i].dependencies == 0) launch(i, world, dt);
+        }
+        pool_.wait(remaining_);
+        world.flush();
+#if ECS_TELEMETRY
+        telemetry::sample_stores(world);
+#endif
+    }
+
+    void Scheduler::launch(std::size_t index, World& world, float dt) {
+        pool_.submit([this, index, &world, dt] {
+            {
+#if ECS_TELEMETRY
+                telemetry::Scope scope(telemetry::Kind::system, systems_[index]->name(), frame_);
+#endif
+                systems_[index]->run(world, dt);
+            }
+            for(auto dependent: nodes_[index].dependents) {
+                if(nodes_[dependent].waiting.fetch_sub(1) == 1) launch(dependent, world, dt);
+            }
+            remaining_.fetch_sub(1, std::memory_order_release);
+        });
+    }
+}
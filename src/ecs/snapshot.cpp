@@ -0,0 +1,188 @@
+//===--------------------------------------------------------------------------------------------===
+// snapshot.cpp - Binary world snapshots
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/world.hpp>
+#include <ecs/commands.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+
+namespace amyinorbit::ecs {
+
+    namespace {
+        struct Header {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t max_components;
+            std::uint32_t mask_size;
+            std::uint32_t chunk_size;
+            std::uint32_t entities;
+            std::uint32_t free_count;
+            std::uint32_t tick;
+            std::uint32_t stores; // ids of the stores follow the header
+        };
+
+        // Keeps a read-only mapping alive until the end of restore_file().
+        struct Mapping {
+            Mapping(const std::string& path) {
+                fd = ::open(path.c_str(), O_RDONLY);
+                if(fd < 0) throw std::runtime_error("cannot open snapshot: " + path);
+                struct stat info;
+                if(::fstat(fd, &info) != 0) {
+                    ::close(fd);
+                    throw std::runtime_error("cannot stat snapshot: " + path);
+                }
+                size = info.st_size;
+                if(!size) return;
+                auto ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(ptr == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error("cannot map snapshot: " + path);
+                }
+                data = static_cast<const byte*>(ptr);
+            }
+
+            ~Mapping() {
+                if(data) ::munmap(const_cast<byte*>(data), size);
+                ::close(fd);
+            }
+
+            int fd = -1;
+            const byte* data = nullptr;
+            std::size_t size = 0;
+        };
+    }
+
+    std::vector<byte> World::snapshot() const {
+        SnapshotWriter out;
+        Header header;
+        header.magic = snapshot_magic;
+        header.version = snapshot_version;
+        header.max_components = MAX_COMPONENTS;
+        header.mask_size = sizeof(TypeMask);
+        header.chunk_size = ENTITIES_PER_CHUNK;
+        header.entities = next_index_;
+        header.free_count = free_list_.size();
+        header.tick = tick_;
+        header.stores = 0;
+        for(const auto& store: stores_) {
+            if(store) header.stores += 1;
+        }
+        out.write(header);
+        for(Index id = 0; id < MAX_COMPONENTS; ++id) {
+            if(stores_[id]) out.write<std::uint32_t>(id);
+        }
+
+        out.write(masks_.data(), next_index_ * sizeof(TypeMask));
+        out.write(versions_.data(), next_index_ * sizeof(Index));
+        out.write(free_list_.data(), free_list_.size() * sizeof(Index));
+
+        for(Index id = 0; id < MAX_COMPONENTS; ++id) {
+            if(!stores_[id]) continue;
+            out.write<std::uint32_t>(id);
+            stores_[id]->save(out, masks_.data(), next_index_);
+        }
+        return std::move(out.data());
+    }
+
+    void World::restore(const byte* data, std::size_t size) {
+        SnapshotReader in(data, size);
+        auto header = in.read<Header>();
+        if(header.magic != snapshot_magic) throw std::runtime_error("not an ECS snapshot");
+        if(header.version != snapshot_version
+            || header.max_components != MAX_COMPONENTS
+            || header.mask_size != sizeof(TypeMask)
+            || header.chunk_size != ENTITIES_PER_CHUNK) {
+            throw std::runtime_error("incompatible ECS snapshot");
+        }
+
+        // Check every store in the snapshot, used or not, exists here before touching the world.
+        auto missing = [](std::size_t id) {
+            return std::runtime_error("no store for snapshot component #" + std::to_string(id)
+                + ", call World::prepare() first");
+        };
+        if(header.stores > MAX_COMPONENTS) throw std::runtime_error("corrupt ECS snapshot");
+        std::vector<std::uint32_t> stores(header.stores);
+        in.read(stores.data(), stores.size() * sizeof(std::uint32_t));
+        TypeMask saved;
+        for(auto id: stores) {
+            if(id >= MAX_COMPONENTS) throw std::runtime_error("corrupt ECS snapshot");
+            if(!stores_[id]) throw missing(id);
+            saved.set(id);
+        }
+
+        auto masks = in.take(header.entities * sizeof(TypeMask));
+        TypeMask used;
+        for(Index id = 0; id < header.entities; ++id) {
+            TypeMask mask;
+            std::memcpy(&mask, masks + id * sizeof(TypeMask), sizeof(TypeMask));
+            used |= mask;
+        }
+        if(!saved.contains(used)) throw std::runtime_error("corrupt ECS snapshot");
+
+        for(Index id = 0; id < next_index_; ++id) {
+            masks_[id].each([&](std::size_t component) {
+                stores_[component]->destroy(id);
+                removals_[component] += 1;
+            });
+        }
+        {
+            std::lock_guard<std::mutex> guard(commands_lock_);
+            for(auto& [owner, buffer]: command_buffers_) {
+                buffer->clear();
+            }
+        }
+
+        masks_.resize(header.entities);
+        versions_.resize(header.entities);
+        free_list_.resize(header.free_count);
+        std::memcpy(masks_.data(), masks, header.entities * sizeof(TypeMask));
+        in.read(versions_.data(), header.entities * sizeof(Index));
+        in.read(free_list_.data(), header.free_count * sizeof(Index));
+
+        next_index_ = header.entities;
+        reserved_.store(header.entities);
+        free_cursor_.store(header.free_count);
+        tick_ = header.tick;
+
+        try {
+            for(auto expected: stores) {
+                auto id = in.read<std::uint32_t>();
+                if(id != expected) throw std::runtime_error("corrupt ECS snapshot");
+                stores_[id]->load(in, masks_.data(), next_index_);
+            }
+            rebuild_queries();
+        } catch(...) {
+            // Leave an empty (if leaky) world rather than masks pointing at garbage.
+            masks_.clear();
+            versions_.clear();
+            free_list_.clear();
+            next_index_ = 0;
+            reserved_.store(0);
+            free_cursor_.store(0);
+            rebuild_queries();
+            throw;
+        }
+    }
+
+    void World::save_file(const std::string& path) const {
+        auto data = snapshot();
+        auto file = std::fopen(path.c_str(), "wb");
+        if(!file) throw std::runtime_error("cannot open snapshot for writing: " + path);
+        auto written = std::fwrite(data.data(), 1, data.size(), file);
+        std::fclose(file);
+        if(written != data.size()) throw std::runtime_error("cannot write snapshot: " + path);
+    }
+
+    void World::restore_file(const std::string& path) {
+        Mapping map(path);
+        restore(map.data, map.size);
+    }
+}
@@ -0,0 +1,112 @@
+//===--------------------------------------------------------------------------------------------===
+// spatial.cpp - Spatial indices over entity positions
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/spatial.hpp>
+#include <cassert>
+
+namespace amyinorbit::ecs {
+
+    void SpatialCells::place(Index id, const Point& center, float radius, std::uint64_t cell) {
+        if(id >= entries_.size()) entries_.resize(id + 1);
+        auto& entry = entries_[id];
+        entry.center = center;
+        entry.radius = radius;
+        if(entry.slot != npos && entry.cell == cell) return;
+
+        if(entry.slot != npos) remove(id);
+        auto& members = cells_[cell];
+        entry.cell = cell;
+        entry.slot = Index(members.size());
+        members.push_back(id);
+        size_ += 1;
+    }
+
+    void SpatialCells::remove(Index id) {
+        assert(contains(id));
+        auto& entry = entries_[id];
+        auto it = cells_.find(entry.cell);
+        auto& members = it->second;
+        auto last = members.back();
+        members[entry.slot] = last;
+        entries_[last].slot = entry.slot;
+        members.pop_back();
+        if(members.empty()) cells_.erase(it);
+        entry.slot = npos;
+        size_ -= 1;
+    }
+
+    // MARK: - Hash grid
+
+    void HashGrid::insert(Index id, const Point& center, float radius) {
+        max_radius_ = std::max(max_radius_, radius);
+        place(id, center, radius, key(cell(center.x), cell(center.y), cell(center.z)));
+    }
+
+    std::int32_t HashGrid::cell(float v) const {
+        return std::int32_t(std::floor(v / cell_size_));
+    }
+
+    std::uint64_t HashGrid::key(std::int32_t x, std::int32_t y, std::int32_t z) {
+        // 21 bits per axis: about a million cells either side of the origin.
+        constexpr std::uint64_t mask = (1 << 21) - 1;
+        return (std::uint64_t(x) & mask)
+            | ((std::uint64_t(y) & mask) << 21)
+            | ((std::uint64_t(z) & mask) << 42);
+    }
+
+    // MARK: - Loose octree
+
+    LooseOctree::LooseOctree(const Point& center, float extent, int depth)
+        : origin_{center.x - extent, center.y - extent, center.z - extent}
+        , size_(2.f * extent)
+        , depth_(std::min(std::max(depth, 0), max_depth))
+        , occupied_(depth_ + 1) {}
+
+    void LooseOctree::insert(Index id, const Point& center, float radius) {
+        int level = depth_;
+        if(radius > 0.f) {
+            // Deepest level whose cells are at least as wide as the entry.
+            level = int(std::floor(std::log2(size_ / (2.f * radius))));
+            level = std::min(std::max(level, 0), depth_);
+        }
+
+        std::uint64_t cell_key = key(0, 0, 0, 0);
+        if(level > 0) {
+            const float cell = size_ / float(1 << level);
+            auto x = std::floor((center.x - origin_.x) / cell);
+            auto y = std::floor((center.y - origin_.y) / cell);
+            auto z = std::floor((center.z - origin_.z) / cell);
+            const float cells = float(1 << level);
+            if(x >= 0 && y >= 0 && z >= 0 && x < cells && y < cells && z < cells) {
+                cell_key = key(level, std::uint32_t(x), std::uint32_t(y), std::uint32_t(z));
+            } else {
+                level = 0;
+            }
+        }
+
+        if(contains(id) && entries_[id].cell != cell_key) erase(id);
+        bool moved = !contains(id);
+        place(id, center, radius, cell_key);
+        if(moved) occupied_[level][cell_key] += 1;
+    }
+
+    void LooseOctree::erase(Index id) {
+        auto cell_key = entries_[id].cell;
+        auto& occupied = occupied_[cell_key >> 60];
+        auto it = occupied.find(cell_key);
+        if(--it->second == 0) occupied.erase(it);
+        remove(id);
+    }
+
+    std::uint64_t LooseOctree::key(int level, std::uint32_t x, std::uint32_t y, std::uint32_t z) {
+        return (std::uint64_t(level) << 60)
+            | std::uint64_t(x)
+            | (std::uint64_t(y) << 20)
+            | (std::uint64_t(z) << 40);
+    }
+}
@@ -0,0 +1,90 @@
+//===--------------------------------------------------------------------------------------------===
+// store.cpp - Component storage backends
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/store.hpp>
+#include <algorithm>
+
+namespace amyinorbit::ecs {
+
+    ChunkedStore::ChunkedStore(std::size_t elt_size, std::size_t align,
+                               std::pmr::memory_resource* resource, std::size_t chunk_size)
+        : elt_size_(elt_size)
+        , chunk_size_(chunk_size ? chunk_size : elt_size * ENTITIES_PER_CHUNK)
+        , align_(std::max<std::size_t>(align, CACHE_LINE_SIZE))
+        , resource_(resource) {}
+
+    ChunkedStore::ChunkedStore(ChunkedStore&& other)
+        : elt_size_(other.elt_size_)
+        , chunk_size_(other.chunk_size_)
+        , align_(other.align_)
+        , resource_(other.resource_)
+        , chunks_(std::move(other.chunks_))
+        , ticks_(std::move(other.ticks_)) {
+        other.chunks_.clear();
+        other.ticks_.clear();
+    }
+
+    ChunkedStore& ChunkedStore::operator=(ChunkedStore&& other) {
+        if(&other != this) {
+            release();
+            elt_size_ = other.elt_size_;
+            chunk_size_ = other.chunk_size_;
+            align_ = other.align_;
+            resource_ = other.resource_;
+            chunks_ = std::move(other.chunks_);
+            ticks_ = std::move(other.ticks_);
+            other.chunks_.clear();
+            other.ticks_.clear();
+        }
+        return *this;
+    }
+
+    ChunkedStore::~ChunkedStore() {
+        release();
+    }
+
+    void ChunkedStore::reserve(std::size_t count) {
+        while(capacity() < count) {
+            auto chunk = resource_->allocate(chunk_size_, align_);
+            chunks_.push_back(static_cast<byte*>(chunk));
+            auto ticks = resource_->allocate(sizeof(Tick) * ENTITIES_PER_CHUNK, CACHE_LINE_SIZE);
+            ticks_.push_back(static_cast<Tick*>(ticks));
+            std::fill_n(ticks_.back(), ENTITIES_PER_CHUNK, Tick(0));
+        }
+    }
+
+    void ChunkedStore::release() {
+        for(auto chunk: chunks_) {
+            resource_->deallocate(chunk, chunk_size_, align_);
+        }
+        for(auto ticks: ticks_) {
+            resource_->deallocate(ticks, sizeof(Tick) * ENTITIES_PER_CHUNK, CACHE_LINE_SIZE);
+        }
+        chunks_.clear();
+        ticks_.clear();
+    }
+
+    void ChunkedStore::save_chunks(SnapshotWriter& out, Index count, bool raw) const {
+        auto chunks = std::min<std::size_t>(
+            chunks_.size(), (std::size_t(count) + ENTITIES_PER_CHUNK - 1) / ENTITIES_PER_CHUNK);
+        out.write<std::uint32_t>(std::uint32_t(chunks));
+        for(std::size_t i = 0; i < chunks; ++i) {
+            if(raw) out.write(chunks_[i], chunk_size_);
+            out.write(ticks_[i], sizeof(Tick) * ENTITIES_PER_CHUNK);
+        }
+    }
+
+    void ChunkedStore::load_chunks(SnapshotReader& in, bool raw) {
+        auto chunks = in.read<std::uint32_t>();
+        reserve(std::size_t(chunks) * ENTITIES_PER_CHUNK);
+        for(std::size_t i = 0; i < chunks; ++i) {
+            if(raw) in.read(chunks_[i], chunk_size_);
+            in.read(ticks_[i], sizeof(Tick) * ENTITIES_PER_CHUNK);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+//===--------------------------------------------------------------------------------------------===
+// telemetry.cpp - Frame, system and query instrumentation
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/telemetry.hpp>
+#include <ecs/world.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+namespace amyinorbit::ecs::telemetry {
+
+    const char* kind_name(Kind kind) {
+        switch(kind) {
+        case Kind::frame: return "frame";
+        case Kind::system: return "system";
+        case Kind::query: return "query";
+        case Kind::store: return "store";
+        }
+        return "unknown";
+    }
+
+    namespace {
+        // System names come from typeid(); everything else is already readable.
+        std::string readable(Kind kind, const char* name) {
+#if defined(__GNUG__)
+            if(kind == Kind::system) {
+                int status = 0;
+                std::unique_ptr<char, void (*)(void*)> demangled(
+                    abi::__cxa_demangle(name, nullptr, nullptr, &status), std::free);
+                if(status == 0) return demangled.get();
+            }
+#endif
+            return name;
+        }
+
+#if ECS_TELEMETRY
+        struct Recorder {
+            RingBuffer<Sample, 1 << 14> samples;
+            std::atomic<std::uint64_t> dropped{0};
+            std::atomic<std::uint64_t> frame{0};
+            std::atomic<std::uint64_t> last_stores{0};
+        };
+
+        Recorder& recorder() {
+            static Recorder instance;
+            return instance;
+        }
+
+        constexpr std::uint64_t store_interval_ns = 250'000'000;
+#endif
+    }
+
+#if ECS_TELEMETRY
+    void record(const Sample& sample) {
+        auto& r = recorder();
+        if(!r.samples.push(sample)) r.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t frame() {
+        return recorder().frame.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t next_frame() {
+        return recorder().frame.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    void sample_stores(const World& world) {
+        auto& r = recorder();
+        auto now = now_ns();
+        auto last = r.last_stores.load(std::memory_order_relaxed);
+        if(now - last < store_interval_ns) return;
+        if(!r.last_stores.compare_exchange_strong(last, now)) return;
+
+        auto current = frame();
+        for(const auto& s: world.store_stats()) {
+            record(Sample{Kind::store, s.name, current, 0, s.live, s.capacity, s.bytes});
+        }
+    }
+
+    std::uint64_t& visited() {
+        thread_local std::uint64_t count = 0;
+        return count;
+    }
+#endif
+
+    std::uint64_t Monitor::dropped() const {
+#if ECS_TELEMETRY
+        return recorder().dropped.load(std::memory_order_relaxed);
+#else
+        return 0;
+#endif
+    }
+
+    void Monitor::update() {
+#if ECS_TELEMETRY
+        constexpr double smoothing = 0.05;
+        auto& ring = recorder().samples;
+        Sample sample;
+        while(ring.pop(sample)) {
+            auto& s = find(sample);
+            auto ms = double(sample.wall_ns) * 1e-6;
+            s.last_ms = ms;
+            s.average_ms = s.calls ? s.average_ms + (ms - s.average_ms) * smoothing : ms;
+            s.max_ms = std::max(s.max_ms, ms);
+            s.entities = sample.entities;
+            s.capacity = sample.capacity;
+            s.bytes = sample.bytes;
+            s.calls += 1;
+
+            history_.push_back(sample);
+            if(history_.size() > history_size_) history_.pop_front();
+        }
+#endif
+    }
+
+    auto Monitor::find(const Sample& sample) -> Series& {
+        for(auto& s: series_) {
+            if(s.kind != sample.kind) continue;
+            if(s.key == sample.name || !std::strcmp(s.key, sample.name)) return s;
+        }
+        series_.push_back(Series{sample.kind, sample.name, readable(sample.kind, sample.name)});
+        return series_.back();
+    }
+
+    bool Monitor::dump_csv(const std::string& path) const {
+        auto file = std::fopen(path.c_str(), "w");
+        if(!file) return false;
+        std::fprintf(file, "frame,kind,name,wall_ns,entities,capacity,bytes\n");
+        for(const auto& sample: history_) {
+            std::fprintf(file, "%llu,%s,\"%s\",%llu,%llu,%llu,%llu\n",
+                (unsigned long long)sample.frame, kind_name(sample.kind),
+                readable(sample.kind, sample.name).c_str(),
+                (unsigned long long)sample.wall_ns, (unsigned long long)sample.entities,
+                (unsigned long long)sample.capacity, (unsigned long long)sample.bytes);
+        }
+        return std::fclose(file) == 0;
+    }
+}
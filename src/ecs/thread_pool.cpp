@@ -0,0 +1,144 @@
+//===--------------------------------------------------------------------------------------------===
+// thread_pool.cpp - Work-stealing thread pool
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/thread_pool.hpp>
+#include <algorithm>
+
+namespace amyinorbit::ecs {
+
+    namespace {
+        // Identifies the pool (and queue) the current thread works for, if any.
+        thread_local const ThreadPool* current_pool = nullptr;
+        thread_local unsigned current_queue = 0;
+    }
+
+    ThreadPool::ThreadPool(unsigned workers) {
+        workers = std::max(workers, 1u);
+        for(unsigned i = 0; i < workers; ++i) {
+            queues_.emplace_back(new Queue());
+        }
+        for(unsigned i = 0; i < workers; ++i) {
+            threads_.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock_);
+            done_ = true;
+        }
+        wake_.notify_all();
+        for(auto& thread: threads_) {
+            thread.join();
+        }
+    }
+
+    ThreadPool& ThreadPool::shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    unsigned ThreadPool::default_workers() {
+        auto hw = std::thread::hardware_concurrency();
+        return hw > 1 ? hw - 1 : 1;
+    }
+
+    void ThreadPool::submit(Task task) {
+        auto index = current_pool == this
+            ? current_queue
+            : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        {
+            std::lock_guard<std::mutex> guard(queues_[index]->lock);
+            queues_[index]->tasks.push_back(std::move(task));
+            pending_.fetch_add(1, std::memory_order_release);
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock_);
+        }
+        wake_.notify_one();
+    }
+
+    void ThreadPool::wait(const std::atomic<std::size_t>& remaining) {
+        while(remaining.load(std::memory_order_acquire) != 0) {
+            Task task;
+            if(find_task(task)) {
+                task();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void ThreadPool::parallel_for(Index begin, Index end, Index grain,
+                                  const std::function<void(Index, Index)>& fn) {
+        if(begin >= end) return;
+        grain = std::max(grain, Index(1));
+        if(end - begin <= grain) {
+            fn(begin, end);
+            return;
+        }
+
+        std::atomic<std::size_t> remaining{(end - begin - 1) / grain};
+        for(Index from = begin + grain; from < end;) {
+            auto to = from + std::min(grain, end - from);
+            submit([&fn, &remaining, from, to] {
+                fn(from, to);
+                remaining.fetch_sub(1, std::memory_order_release);
+            });
+            from = to;
+        }
+        fn(begin, begin + grain);
+        wait(remaining);
+    }
+
+    bool ThreadPool::pop(unsigned index, Task& task) {
+        auto& queue = *queues_[index];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if(queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool ThreadPool::steal(unsigned index, Task& task) {
+        for(unsigned i = 1; i <= queues_.size(); ++i) {
+            auto& queue = *queues_[(index + i) % queues_.size()];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if(queue.tasks.empty()) continue;
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    bool ThreadPool::find_task(Task& task) {
+        if(pending_.load(std::memory_order_acquire) == 0) return false;
+        if(current_pool == this && pop(current_queue, task)) return true;
+        return steal(current_pool == this ? current_queue : 0, task);
+    }
+
+    void ThreadPool::work(unsigned index) {
+        current_pool = this;
+        current_queue = index;
+
+        for(;;) {
+            Task task;
+            if(find_task(task)) {
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_lock_);
+            wake_.wait(lock, [this] { return done_ || pending_.load() != 0; });
+            if(done_ && pending_.load() == 0) return;
+        }
+    }
+}
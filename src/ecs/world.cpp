@@ -7,79 +7,177 @@
 // =^•.•^=
 //===--------------------------------------------------------------------------------------------===
 #include <ecs/world.hpp>
-#ifndef NDEBUG
-#include <iostream>
-#endif
+#include <ecs/commands.hpp>
 
 namespace amyinorbit::ecs {
 
-    Store::Store(std::size_t elt_size, std::size_t count) : elt_size_(elt_size), count_(count) {
-        data_ = new byte[elt_size * count];
+    namespace {
+        std::atomic<std::uint64_t> world_serial{0};
     }
 
-    Store::Store(Store&& other) : elt_size_(other.elt_size_), count_(other.count_) {
-        data_ = other.data_;
-        other.reset();
-    }
+    World::World(const ArenaOptions& options)
+        : arena_(std::make_unique<ArenaResource>(options))
+        , resource_(arena_.get())
+        , masks_(resource_)
+        , versions_(resource_)
+        , free_list_(resource_)
+        , serial_(++world_serial) {}
+
+    World::World(std::pmr::memory_resource* resource)
+        : resource_(resource)
+        , masks_(resource_)
+        , versions_(resource_)
+        , free_list_(resource_)
+        , serial_(++world_serial) {}
 
-    Store& Store::operator=(Store&& other) {
-        if(&other != this) {
-            delete [] data_;
-            elt_size_ = other.elt_size_;
-            count_ = other.count_;
-            data_ = other.data_;
-            other.reset();
+    World::~World() {
+        for(Index id = 0; id < next_index_; ++id) {
+            masks_[id].each([&](std::size_t component) { stores_[component]->destroy(id); });
         }
-        return *this;
     }
 
-    Store::~Store() {
-        delete [] data_;
-        reset();
+    Entity World::create() {
+        auto entity = reserve();
+        materialize();
+        return entity;
     }
 
-    byte* Store::ptr(Index index) {
-        return data_ + index * count_;
-    }
+    void World::allocate(Entity* out, Index count, const TypeMask& mask) {
+        materialize();
 
-    const byte* Store::ptr(Index index) const {
-        return data_ + index * count_;
+        Index recycled = std::min<Index>(count, Index(free_list_.size()));
+        for(Index i = 0; i < recycled; ++i) {
+            auto id = free_list_[free_list_.size() - 1 - i];
+            masks_[id] = mask;
+            out[i] = Entity{id, versions_[id]};
+        }
+        free_list_.resize(free_list_.size() - recycled);
+        free_cursor_.store(free_list_.size());
+
+        auto first = next_index_;
+        auto fresh = count - recycled;
+        next_index_ += fresh;
+        reserved_.store(next_index_);
+        masks_.resize(next_index_, mask);
+        versions_.resize(next_index_, 1);
+        for(Index i = 0; i < fresh; ++i) {
+            out[recycled + i] = Entity{first + i, 1};
+        }
+
+        for(auto query: query_list_) {
+            if(!mask.contains(query->mask())) continue;
+            for(Index i = 0; i < count; ++i) query->insert(out[i].id);
+        }
     }
 
-    World::World() {
-        for(Index id = 0; id < MAX_ENTITIES; ++id) {
-            masks_[id] = 0;
-            versions_[id] = 0;
-            stores_[0] = nullptr;
+    Entity World::reserve() {
+        auto slot = free_cursor_.fetch_sub(1);
+        if(slot > 0) {
+            auto id = free_list_[slot - 1];
+            return Entity{id, versions_[id]};
         }
+        return Entity{reserved_.fetch_add(1), 1};
     }
 
-    Entity World::create() {
-        if(free_list_.size()) {
-            auto idx = free_list_.back();
-            free_list_.pop_back();
-            std::cout << "Creating from free list: " << idx << "\n";
-            return Entity{idx, versions_[idx]};
+    void World::materialize() {
+        auto cursor = free_cursor_.load();
+        free_list_.resize(cursor > 0 ? cursor : 0);
+        free_cursor_.store(free_list_.size());
+
+        auto count = reserved_.load();
+        masks_.resize(count, TypeMask());
+        versions_.resize(count, 1);
+        next_index_ = count;
+    }
+
+    CommandBuffer& World::commands() {
+        // Fast path: the thread asked this world for its buffer last time too.
+        thread_local std::uint64_t cached_world = 0;
+        thread_local CommandBuffer* cached_buffer = nullptr;
+        if(cached_world == serial_) return *cached_buffer;
+
+        auto thread = std::this_thread::get_id();
+        std::lock_guard<std::mutex> guard(commands_lock_);
+        CommandBuffer* buffer = nullptr;
+        for(const auto& [owner, candidate]: command_buffers_) {
+            if(owner == thread) buffer = candidate.get();
         }
-        assert(next_index_ < MAX_ENTITIES);
+        if(!buffer) {
+            command_buffers_.emplace_back(thread, std::make_unique<CommandBuffer>(*this));
+            buffer = command_buffers_.back().second.get();
+        }
+        cached_world = serial_;
+        cached_buffer = buffer;
+        return *buffer;
+    }
 
-        auto id = next_index_++;
-        versions_[id] = 1;
-        std::cout << "Creating new entity: " << id << "\n";
-        return Entity{id, versions_[id]};
+    void World::flush() {
+        materialize();
+        std::lock_guard<std::mutex> guard(commands_lock_);
+        for(auto& [owner, buffer]: command_buffers_) {
+            buffer->apply();
+        }
     }
 
     void World::destroy(Entity entity) {
         assert(is_valid(entity));
-        auto cmask = masks_[entity.id];
-        for(auto& store: stores_) {
-            if(!store) continue;
-            if(!(store->mask() & cmask)) continue;
-            store->destroy(entity.id);
-        }
+        masks_[entity.id].each([&](std::size_t component) {
+            stores_[component]->destroy(entity.id);
+            removals_[component] += 1;
+        });
 
-        masks_[entity.id] = 0;
+        auto old = masks_[entity.id];
+        masks_[entity.id] = TypeMask();
+        update_queries(entity.id, old);
         versions_[entity.id] += 1;
         free_list_.push_back(entity.id);
+        free_cursor_.store(free_list_.size());
+    }
+
+    const Query& World::cached_query(const TypeMask& mask) {
+        std::lock_guard<std::mutex> guard(queries_lock_);
+        auto it = queries_.find(mask);
+        if(it != queries_.end()) {
+            query_hits_ += 1;
+            return *it->second;
+        }
+
+        query_misses_ += 1;
+        auto query = std::make_unique<Query>(mask);
+        for(Index id = 0; id < next_index_; ++id) {
+            if(masks_[id].contains(mask)) query->insert(id);
+        }
+        query_list_.push_back(query.get());
+        return *queries_.emplace(mask, std::move(query)).first->second;
+    }
+
+    void World::rebuild_queries() {
+        for(auto query: query_list_) {
+            query->clear();
+            for(Index id = 0; id < next_index_; ++id) {
+                if(masks_[id].contains(query->mask())) query->insert(id);
+            }
+        }
+    }
+
+    QueryStats World::query_stats() const {
+        std::lock_guard<std::mutex> guard(queries_lock_);
+        return QueryStats{query_hits_, query_misses_, queries_.size()};
+    }
+
+    std::vector<StoreStats> World::store_stats() const {
+        Index live[MAX_COMPONENTS] = {};
+        for(Index id = 0; id < next_index_; ++id) {
+            masks_[id].each([&](std::size_t component) { live[component] += 1; });
+        }
+
+        std::vector<StoreStats> stats;
+        for(Index component = 0; component < MAX_COMPONENTS; ++component) {
+            const auto& store = stores_[component];
+            if(!store) continue;
+            stats.push_back(StoreStats{component, store->name(), store->kind(), live[component],
+                                       store->capacity(), store->bytes()});
+        }
+        return stats;
     }
 }
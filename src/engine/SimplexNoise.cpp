@@ -25,7 +25,10 @@
  */
 
 #include "SimplexNoise.h"
+#include "hash.hpp"
+#include "simplex_batch.hpp"
 
+#include <algorithm>  // std::min/std::swap
 #include <cstdint>  // int32_t/uint8_t
 
 /**
@@ -58,17 +61,15 @@ static inline int32_t fastfloor(float fp) {
  * so it's easiest to just keep it as static explicit data.
  * This also removes the need for any initialisation of this class.
  *
- * Note that making this an uint32_t[] instead of a uint8_t[] might make the
- * code run faster on platforms with a high penalty for unaligned single
- * byte addressing. Intel x86 is generally single-byte-friendly, but
- * some other CPUs are faster with 4-aligned reads.
- * However, a char[] is smaller, which avoids cache trashing, and that
- * is probably the most important aspect on most architectures.
+ * It is stored as an int32_t[] rather than a uint8_t[] so that the vector
+ * kernels can gather from it directly; at 1KB it still fits in the cache.
  * This array is accessed a *lot* by the noise functions.
  * A vector-valued noise over 3D accesses it 96 times, and a
  * float-valued 4D noise 64 times. We want this to fit in the cache!
+ *
+ * Seeded generators use a shuffled copy of it instead (see the constructor).
  */
-static const uint8_t perm[256] = {
+static const int32_t perm[256] = {
     151, 160, 137, 91, 90, 15,
     131, 13, 201, 95, 96, 53, 194, 233, 7, 225, 140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23,
     190, 6, 148, 247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32, 57, 177, 33,
@@ -92,12 +93,13 @@ static const uint8_t perm[256] = {
  *  Using a real hash function would be better to improve the "repeatability of 256" of the above permutation table,
  * but fast integer Hash functions uses more time and have bad random properties.
  *
- * @param[in] i Integer value to hash
+ * @param[in] table  Permutation table to use
+ * @param[in] i      Integer value to hash
  *
  * @return 8-bits hashed value
  */
-static inline uint8_t hash(int32_t i) {
-    return perm[static_cast<uint8_t>(i)];
+static inline int32_t hash(const int32_t* table, int32_t i) {
+    return table[static_cast<uint8_t>(i)];
 }
 
 /* NOTE Gradient table to test if lookup-table are more efficient than calculs
@@ -168,11 +170,12 @@ static float grad(int32_t hash, float x, float y, float z) {
  *
  *  Takes around 74ns on an AMD APU.
  *
+ * @param[in] perm permutation table
  * @param[in] x float coordinate
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x) {
+float SimplexNoise::noise(const int32_t* perm, float x) {
     float n0, n1;   // Noise contributions from the two "corners"
 
     // No need to skew the input space in 1D
@@ -188,13 +191,13 @@ float SimplexNoise::noise(float x) {
     float t0 = 1.0f - x0*x0;
 //  if(t0 < 0.0f) t0 = 0.0f; // not possible
     t0 *= t0;
-    n0 = t0 * t0 * grad(hash(i0), x0);
+    n0 = t0 * t0 * grad(hash(perm, i0), x0);
 
     // Calculate the contribution from the second corner
     float t1 = 1.0f - x1*x1;
 //  if(t1 < 0.0f) t1 = 0.0f; // not possible
     t1 *= t1;
-    n1 = t1 * t1 * grad(hash(i1), x1);
+    n1 = t1 * t1 * grad(hash(perm, i1), x1);
 
     // The maximum value of this noise is 8*(3/4)^4 = 2.53125
     // A factor of 0.395 scales to fit exactly within [-1,1]
@@ -206,12 +209,13 @@ float SimplexNoise::noise(float x) {
  *
  *  Takes around 150ns on an AMD APU.
  *
+ * @param[in] perm permutation table
  * @param[in] x float coordinate
  * @param[in] y float coordinate
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y) {
+float SimplexNoise::noise(const int32_t* perm, float x, float y) {
     float n0, n1, n2;   // Noise contributions from the three corners
 
     // Skewing/Unskewing factors for 2D
@@ -253,9 +257,9 @@ float SimplexNoise::noise(float x, float y) {
     const float y2 = y0 - 1.0f + 2.0f * G2;
 
     // Work out the hashed gradient indices of the three simplex corners
-    const int gi0 = hash(i + hash(j));
-    const int gi1 = hash(i + i1 + hash(j + j1));
-    const int gi2 = hash(i + 1 + hash(j + 1));
+    const int gi0 = hash(perm, i + hash(perm, j));
+    const int gi1 = hash(perm, i + i1 + hash(perm, j + j1));
+    const int gi2 = hash(perm, i + 1 + hash(perm, j + 1));
 
     // Calculate the contribution from the first corner
     float t0 = 0.5f - x0*x0 - y0*y0;
@@ -293,13 +297,14 @@ float SimplexNoise::noise(float x, float y) {
 /**
  * 3D Perlin simplex noise
  *
+ * @param[in] perm permutation table
  * @param[in] x float coordinate
  * @param[in] y float coordinate
  * @param[in] z float coordinate
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y, float z) {
+float SimplexNoise::noise(const int32_t* perm, float x, float y, float z) {
     float n0, n1, n2, n3; // Noise contributions from the four corners
 
     // Skewing/Unskewing factors for 3D
@@ -356,10 +361,10 @@ float SimplexNoise::noise(float x, float y, float z) {
     float z3 = z0 - 1.0f + 3.0f * G3;
 
     // Work out the hashed gradient indices of the four simplex corners
-    int gi0 = hash(i + hash(j + hash(k)));
-    int gi1 = hash(i + i1 + hash(j + j1 + hash(k + k1)));
-    int gi2 = hash(i + i2 + hash(j + j2 + hash(k + k2)));
-    int gi3 = hash(i + 1 + hash(j + 1 + hash(k + 1)));
+    int gi0 = hash(perm, i + hash(perm, j + hash(perm, k)));
+    int gi1 = hash(perm, i + i1 + hash(perm, j + j1 + hash(perm, k + k1)));
+    int gi2 = hash(perm, i + i2 + hash(perm, j + j2 + hash(perm, k + k2)));
+    int gi3 = hash(perm, i + 1 + hash(perm, j + 1 + hash(perm, k + 1)));
 
     // Calculate the contribution from the four corners
     float t0 = 0.6f - x0*x0 - y0*y0 - z0*z0;
@@ -396,6 +401,48 @@ float SimplexNoise::noise(float x, float y, float z) {
 }
 
 
+// 1D, 2D and 3D Perlin simplex noise on the default permutation table
+float SimplexNoise::noise(float x) {
+    return noise(perm, x);
+}
+
+float SimplexNoise::noise(float x, float y) {
+    return noise(perm, x, y);
+}
+
+float SimplexNoise::noise(float x, float y, float z) {
+    return noise(perm, x, y, z);
+}
+
+/**
+ * Constructor of to initialize a fractal noise summation
+ *
+ * Seed 0 uses the default permutation table. Any other seed shuffles it
+ * (Fisher-Yates, drawing from a PCG hash of the seed and the step), so a
+ * generator only depends on its own parameters and never on shared RNG state.
+ *
+ * @param[in] frequency    Frequency ("width") of the first octave of noise
+ * @param[in] amplitude    Amplitude ("height") of the first octave of noise
+ * @param[in] lacunarity   Frequency multiplier between successive octaves
+ * @param[in] persistence  Loss of amplitude between successive octaves
+ * @param[in] seed         Seed of the permutation table
+ */
+SimplexNoise::SimplexNoise(float frequency, float amplitude, float lacunarity,
+                           float persistence, uint32_t seed) :
+    mFrequency(frequency),
+    mAmplitude(amplitude),
+    mLacunarity(lacunarity),
+    mPersistence(persistence) {
+    for (int i = 0; i < 256; i++) {
+        mPerm[i] = perm[i];
+    }
+    if (seed == 0) return;
+    for (uint32_t i = 255; i > 0; i--) {
+        uint32_t j = amyinorbit::pcg_hash(seed ^ amyinorbit::pcg_hash(i)) % (i + 1);
+        std::swap(mPerm[i], mPerm[j]);
+    }
+}
+
 /**
  * Fractal/Fractional Brownian Motion (fBm) summation of 1D Perlin Simplex noise
  *
@@ -411,7 +458,7 @@ float SimplexNoise::fractal(size_t octaves, float x) const {
     float amplitude = mAmplitude;
 
     for (size_t i = 0; i < octaves; i++) {
-        output += (amplitude * noise(x * frequency));
+        output += (amplitude * noise(mPerm, x * frequency));
         denom += amplitude;
 
         frequency *= mLacunarity;
@@ -437,7 +484,7 @@ float SimplexNoise::fractal(size_t octaves, float x, float y) const {
     float amplitude = mAmplitude;
 
     for (size_t i = 0; i < octaves; i++) {
-        output += (amplitude * noise(x * frequency, y * frequency));
+        output += (amplitude * noise(mPerm, x * frequency, y * frequency));
         denom += amplitude;
 
         frequency *= mLacunarity;
@@ -464,7 +511,7 @@ float SimplexNoise::fractal(size_t octaves, float x, float y, float z) const {
     float amplitude = mAmplitude;
 
     for (size_t i = 0; i < octaves; i++) {
-        output += (amplitude * noise(x * frequency, y * frequency, z * frequency));
+        output += (amplitude * noise(mPerm, x * frequency, y * frequency, z * frequency));
         denom += amplitude;
 
         frequency *= mLacunarity;
@@ -473,3 +520,133 @@ float SimplexNoise::fractal(size_t octaves, float x, float y, float z) const {
 
     return (output / denom);
 }
+
+/**
+ * Runs a batch on the requested instruction set, or on the scalar functions when the build or
+ * the CPU does not support it.
+ *
+ * @param[in] isa       requested instruction set, lowered to best_isa() if needed
+ * @param[in] table     permutation table for the vector kernels
+ * @param[in] fbm       octave parameters for the vector kernels
+ * @param[out] out      count results
+ * @param[in] count     number of points
+ * @param[in] scalar    scalar reference, called for each point on the scalar path
+ * @param[in] coords    one array of count coordinates per dimension
+ */
+template <typename Scalar, typename... Coords>
+static void dispatch(SimplexNoise::Isa isa, const int32_t* table,
+                     const amyinorbit::simplex::Fbm& fbm, float* out, size_t count,
+                     const Scalar& scalar, const Coords*... coords) {
+#if THERMALS_SIMPLEX_SIMD
+    using namespace amyinorbit::simplex;
+    switch (std::min(isa, SimplexNoise::best_isa())) {
+    case SimplexNoise::Isa::avx512: return fractal_avx512(table, fbm, coords..., out, count);
+    case SimplexNoise::Isa::avx2: return fractal_avx2(table, fbm, coords..., out, count);
+    case SimplexNoise::Isa::sse41: return fractal_sse41(table, fbm, coords..., out, count);
+    case SimplexNoise::Isa::scalar: break;
+    }
+#else
+    (void)isa;
+    (void)table;
+    (void)fbm;
+#endif
+    for (size_t n = 0; n < count; n++) {
+        out[n] = scalar(coords[n]...);
+    }
+}
+
+/**
+ * Best instruction set for the batched functions
+ *
+ * @return the widest instruction set that this build has kernels for and that the CPU supports
+ */
+SimplexNoise::Isa SimplexNoise::best_isa() {
+#if THERMALS_SIMPLEX_SIMD
+    static const Isa best = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return Isa::avx512;
+        if (__builtin_cpu_supports("avx2")) return Isa::avx2;
+        if (__builtin_cpu_supports("sse4.1")) return Isa::sse41;
+        return Isa::scalar;
+    }();
+    return best;
+#else
+    return Isa::scalar;
+#endif
+}
+
+const char* SimplexNoise::isa_name(Isa isa) {
+    switch (isa) {
+    case Isa::scalar: return "scalar";
+    case Isa::sse41: return "sse4.1";
+    case Isa::avx2: return "avx2";
+    case Isa::avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+/**
+ * Batched 2D Perlin simplex noise
+ *
+ * @param[in] x         count x float coordinates
+ * @param[in] y         count y float coordinates
+ * @param[out] out      count noise values in the range[-1; 1]
+ * @param[in] count     number of points
+ * @param[in] isa       instruction set to run on (defaults to best_isa())
+ */
+void SimplexNoise::noise(const float* x, const float* y, float* out, size_t count, Isa isa) {
+    const amyinorbit::simplex::Fbm fbm{1, 1.0f, 1.0f, 1.0f, 1.0f};
+    dispatch(isa, perm, fbm, out, count, [](float x, float y) { return noise(x, y); }, x, y);
+}
+
+/**
+ * Batched 3D Perlin simplex noise
+ *
+ * @param[in] x         count x float coordinates
+ * @param[in] y         count y float coordinates
+ * @param[in] z         count z float coordinates
+ * @param[out] out      count noise values in the range[-1; 1]
+ * @param[in] count     number of points
+ * @param[in] isa       instruction set to run on (defaults to best_isa())
+ */
+void SimplexNoise::noise(const float* x, const float* y, const float* z, float* out,
+                         size_t count, Isa isa) {
+    const amyinorbit::simplex::Fbm fbm{1, 1.0f, 1.0f, 1.0f, 1.0f};
+    dispatch(isa, perm, fbm, out, count,
+             [](float x, float y, float z) { return noise(x, y, z); }, x, y, z);
+}
+
+/**
+ * Batched fBm summation of 2D Perlin simplex noise
+ *
+ * @param[in] octaves   number of fraction of noise to sum
+ * @param[in] x         count x float coordinates
+ * @param[in] y         count y float coordinates
+ * @param[out] out      count noise values in the range[-1; 1]
+ * @param[in] count     number of points
+ * @param[in] isa       instruction set to run on (defaults to best_isa())
+ */
+void SimplexNoise::fractal(size_t octaves, const float* x, const float* y, float* out,
+                           size_t count, Isa isa) const {
+    const amyinorbit::simplex::Fbm fbm{octaves, mFrequency, mAmplitude, mLacunarity, mPersistence};
+    dispatch(isa, mPerm, fbm, out, count,
+             [&](float x, float y) { return fractal(octaves, x, y); }, x, y);
+}
+
+/**
+ * Batched fBm summation of 3D Perlin simplex noise
+ *
+ * @param[in] octaves   number of fraction of noise to sum
+ * @param[in] x         count x float coordinates
+ * @param[in] y         count y float coordinates
+ * @param[in] z         count z float coordinates
+ * @param[out] out      count noise values in the range[-1; 1]
+ * @param[in] count     number of points
+ * @param[in] isa       instruction set to run on (defaults to best_isa())
+ */
+void SimplexNoise::fractal(size_t octaves, const float* x, const float* y, const float* z,
+                           float* out, size_t count, Isa isa) const {
+    const amyinorbit::simplex::Fbm fbm{octaves, mFrequency, mAmplitude, mLacunarity, mPersistence};
+    dispatch(isa, mPerm, fbm, out, count,
+             [&](float x, float y, float z) { return fractal(octaves, x, y, z); }, x, y, z);
+}
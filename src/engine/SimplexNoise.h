@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cstddef>  // size_t
+#include <cstdint>  // int32_t/uint32_t
 
 /**
  * @brief A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D, 4D).
@@ -28,6 +29,26 @@ public:
     float fractal(size_t octaves, float x, float y) const;
     float fractal(size_t octaves, float x, float y, float z) const;
 
+    // Instruction sets the batched functions can run on, from slowest to fastest
+    enum class Isa { scalar, sse41, avx2, avx512 };
+
+    // Best instruction set supported by this build and by the CPU it runs on
+    static Isa best_isa();
+    static const char* isa_name(Isa isa);
+
+    // Batched 2D/3D noise: out[n] = noise(x[n], y[n](, z[n])) for n in [0, count).
+    // Every instruction set returns the same values as the scalar functions.
+    static void noise(const float* x, const float* y, float* out, size_t count,
+                      Isa isa = best_isa());
+    static void noise(const float* x, const float* y, const float* z, float* out, size_t count,
+                      Isa isa = best_isa());
+
+    // Batched fBm summation: out[n] = fractal(octaves, x[n], y[n](, z[n]))
+    void fractal(size_t octaves, const float* x, const float* y, float* out, size_t count,
+                 Isa isa = best_isa()) const;
+    void fractal(size_t octaves, const float* x, const float* y, const float* z, float* out,
+                 size_t count, Isa isa = best_isa()) const;
+
     /**
      * Constructor of to initialize a fractal noise summation
      *
@@ -35,21 +56,24 @@ public:
      * @param[in] amplitude    Amplitude ("height") of the first octave of noise (default to 1.0)
      * @param[in] lacunarity   Lacunarity specifies the frequency multiplier between successive octaves (default to 2.0).
      * @param[in] persistence  Persistence is the loss of amplitude between successive octaves (usually 1/lacunarity)
+     * @param[in] seed         Seed of the permutation table; 0 is the classic table, same as the static functions
      */
     explicit SimplexNoise(float frequency = 1.0f,
                           float amplitude = 1.0f,
                           float lacunarity = 2.0f,
-                          float persistence = 0.5f) :
-        mFrequency(frequency),
-        mAmplitude(amplitude),
-        mLacunarity(lacunarity),
-        mPersistence(persistence) {
-    }
+                          float persistence = 0.5f,
+                          uint32_t seed = 0);
 
 private:
+    // Noise on a given permutation table
+    static float noise(const int32_t* perm, float x);
+    static float noise(const int32_t* perm, float x, float y);
+    static float noise(const int32_t* perm, float x, float y, float z);
+
     // Parameters of Fractional Brownian Motion (fBm) : sum of N "octaves" of noise
     float mFrequency;   ///< Frequency ("width") of the first octave of noise (default to 1.0)
     float mAmplitude;   ///< Amplitude ("height") of the first octave of noise (default to 1.0)
     float mLacunarity;  ///< Lacunarity specifies the frequency multiplier between successive octaves (default to 2.0).
     float mPersistence; ///< Persistence is the loss of amplitude between successive octaves (usually 1/lacunarity)
+    int32_t mPerm[256]; ///< Permutation table, shuffled by the seed
 };
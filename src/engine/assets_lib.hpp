@@ -10,6 +10,7 @@
 #include <glue/glue.hpp>
 #include <string>
 #include <unordered_map>
+#include "noise_cache.hpp"
 #include "obj_loader.hpp"
 #include <fstream>
 #include <stdexcept>
@@ -25,7 +26,9 @@ namespace amyinorbit {
     class AssetsLib {
     public:
 
-        AssetsLib(const std::string& root) : root_(root) {}
+        // Baked noise goes to cache/noise; [rebake_noise] regenerates all of it.
+        AssetsLib(const std::string& root, bool rebake_noise = false)
+            : root_(root), noise_("cache/noise", rebake_noise) {}
 
         gl::Tex2D texture(const std::string& path) {
             gl::Image img(root_ + "/textures/" + path);
@@ -62,6 +65,8 @@ namespace amyinorbit {
             return meshes_[path] = gl::load_object(file);
         }
 
+        NoiseCache& noise() { return noise_; }
+
         void clear() {
             shaders_.clear();
             meshes_.clear();
@@ -78,5 +83,6 @@ namespace amyinorbit {
         const std::string root_;
         unordered_map<string, Shader> shaders_;
         unordered_map<string, Mesh> meshes_;
+        NoiseCache noise_;
     };
 }
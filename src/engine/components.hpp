@@ -7,6 +7,10 @@
 // =^•.•^=
 //===--------------------------------------------------------------------------------------------===
 #pragma once
+#include <ecs/entity.hpp>
+#include <ecs/meta.hpp>
+#include <ecs/spatial.hpp>
+#include <ecs/store.hpp>
 #include <glue/glue.hpp>
 #include <apmath/matrix.hpp>
 #include <apmath/quaternion.hpp>
@@ -20,52 +24,127 @@ namespace amyinorbit {
     using apm::vec3;
     using apm::quaternion;
 
-    struct Transform {
-
-        void set_position(const vec3& p) { position_ = p; dirty_ = true; }
+    namespace detail {
+        template <typename T> using Value = T;
+        template <typename T> using Pointer = T*;
+
+        template <typename T> T& deref(T& value) { return value; }
+        template <typename T> T& deref(T* ptr) { return *ptr; }
+    }
+
+    // Transform operations, shared by the Transform value type and the TransformRef proxy that
+    // the ECS hands out, since transforms are stored as one array per field. [Field] is either
+    // T (fields held by value) or T* (fields living in the store's arrays).
+    template <template <typename> class Field>
+    class BasicTransform {
+    public:
+        void set_position(const vec3& p) { position_ref() = p; dirty() = true; }
         void set_position(float x, float y, float z) { set_position(vec3(x,y,z)); }
 
-        void set_rotation(const quaternion& r) { rotation_ = r; dirty_ = true; }
+        void set_rotation(const quaternion& r) { rotation_ref() = r; dirty() = true; }
 
-        void set_scale(const vec3& s) { scale_ = s; dirty_ = true; }
+        void set_scale(const vec3& s) { scale_ref() = s; dirty() = true; }
         void set_scale(float x, float y, float z) { set_scale(vec3(x,y,z)); }
         void set_scale(float s) { set_scale(vec3(s)); }
 
-        void translate(const vec3& d) { position_ += d; dirty_ = true; }
-        void rotate(const quaternion& q) { rotation_ = q * rotation_; dirty_ = true; }
-        void scale(const vec3& s) { scale_ *= s; dirty_ = true; }
+        void translate(const vec3& d) { position_ref() += d; dirty() = true; }
+        void rotate(const quaternion& q) { rotation_ref() = q * rotation_ref(); dirty() = true; }
+        void scale(const vec3& s) { scale_ref() *= s; dirty() = true; }
 
         vec3 forward() const {
-            return apm::rotate(apm::forward<float>, rotation_);
+            return apm::rotate(apm::forward<float>, rotation());
         }
 
         vec3 up() const {
-            return apm::rotate(apm::up<float>, rotation_);
+            return apm::rotate(apm::up<float>, rotation());
         }
 
         vec3 right() const {
-            return apm::rotate(apm::right<float>, rotation_);
+            return apm::rotate(apm::right<float>, rotation());
         }
 
-        const vec3& position() const { return position_; }
-        const vec3& scale() const { return scale_; }
-        const quaternion& rotation() const { return rotation_; }
+        const vec3& position() const { return detail::deref(position_); }
+        const vec3& scale() const { return detail::deref(scale_); }
+        const quaternion& rotation() const { return detail::deref(rotation_); }
 
+        // Cached: the first call after a change writes the matrix back into the transform (and so
+        // into the store, through a TransformRef), even though it is const.
         const mat4& transform() const {
-            if(dirty_) {
-                transform_ = apm::translate(position_) * apm::scale(scale_) * apm::mat(rotation_);
-                dirty_ = false;
+            auto& matrix = detail::deref(transform_);
+            if(dirty()) {
+                matrix = compute_transform();
+                dirty() = false;
             }
-            return transform_;
+            return matrix;
+        }
+
+        // The same matrix, computed from the fields without touching the cache. Systems that only
+        // declare Reads<Transform> must use this one.
+        mat4 compute_transform() const {
+            return apm::translate(position()) * apm::scale(scale()) * apm::mat(rotation());
+        }
+
+    protected:
+        template <template <typename> class> friend class BasicTransform;
+
+        BasicTransform(Field<vec3> position, Field<vec3> scale, Field<quaternion> rotation,
+                       Field<mat4> transform, Field<bool> dirty)
+            : dirty_(dirty)
+            , transform_(transform)
+            , position_(position)
+            , scale_(scale)
+            , rotation_(rotation) {}
+
+        template <template <typename> class Other>
+        void assign(const BasicTransform<Other>& other) {
+            position_ref() = other.position();
+            scale_ref() = other.scale();
+            rotation_ref() = other.rotation();
+            detail::deref(transform_) = detail::deref(other.transform_);
+            dirty() = other.dirty();
         }
 
     private:
-        mutable bool dirty_ = true;
-        mutable mat4 transform_;
+        vec3& position_ref() { return detail::deref(position_); }
+        vec3& scale_ref() { return detail::deref(scale_); }
+        quaternion& rotation_ref() { return detail::deref(rotation_); }
+        bool& dirty() const { return detail::deref(dirty_); }
+
+        mutable Field<bool> dirty_;
+        mutable Field<mat4> transform_;
+
+        Field<vec3> position_;
+        Field<vec3> scale_;
+        Field<quaternion> rotation_;
+    };
+
+    struct Transform : BasicTransform<detail::Value> {
+        Transform() : BasicTransform(vec3(0.f), vec3(1.f), quaternion(), mat4(), true) {}
+
+        template <template <typename> class Other>
+        Transform(const BasicTransform<Other>& other) : Transform() { assign(other); }
+    };
 
-        vec3 position_{0.f};
-        vec3 scale_{1.f};
-        quaternion rotation_;
+    // Reference to a Transform in SoA storage. Assigning copies the fields, like a Transform&.
+    struct TransformRef : BasicTransform<detail::Pointer> {
+        TransformRef(vec3* position, vec3* scale, quaternion* rotation, mat4* transform, bool* dirty)
+            : BasicTransform(position, scale, rotation, transform, dirty) {}
+        TransformRef(const TransformRef&) = default;
+
+        TransformRef& operator=(const TransformRef& other) { assign(other); return *this; }
+        TransformRef& operator=(const Transform& other) { assign(other); return *this; }
+    };
+
+    // Makes an entity's Transform relative to [entity]'s. Use attach()/detach() from
+    // hierarchy.hpp rather than adding this directly.
+    struct Parent {
+        ecs::Entity entity;
+    };
+
+    // World-space matrix of an entity in a transform hierarchy, kept up to date by
+    // TransformHierarchy. Entities outside any hierarchy just use Transform::transform().
+    struct WorldTransform {
+        mat4 matrix;
     };
 
     struct Light {
@@ -89,3 +168,30 @@ namespace amyinorbit {
         float time;
     };
 };
+
+// ECS component ids used by the engine. Keep these unique across the program.
+ECS_COMPONENT(amyinorbit::Transform, 0);
+ECS_COMPONENT(amyinorbit::Parent, 2);
+ECS_COMPONENT(amyinorbit::WorldTransform, 3);
+
+namespace amyinorbit::ecs {
+    // Transforms are stored field by field, so loops over positions only touch positions. The
+    // field order matches TransformRef's constructor.
+    template <> struct soa_layout<Transform> {
+        using fields = type_list<vec3, vec3, quaternion, mat4, bool>;
+        using reference = TransformRef;
+        using const_reference = const TransformRef;
+    };
+
+    // Lets SpatialIndex<Transform> bucket entities by their local position.
+    template <> struct spatial_traits<Transform> {
+        static Point position(const TransformRef& t) {
+            const auto& p = t.position();
+            return {p.x, p.y, p.z};
+        }
+    };
+
+    // Most entities are not part of a hierarchy: keep the links in packed pools.
+    template <> struct storage_for<Parent> { using type = SparseStore<Parent>; };
+    template <> struct storage_for<WorldTransform> { using type = SparseStore<WorldTransform>; };
+}
@@ -0,0 +1,27 @@
+//===--------------------------------------------------------------------------------------------===
+// hash.hpp - Counter-based hashing for procedural generation
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cstdint>
+
+namespace amyinorbit {
+
+    // PCG-based integer hash (Jarzynski & Olano, "Hash Functions for GPU Rendering", 2020). Any
+    // value derived from a seed and a counter (a cell index, a step) can be computed on its own,
+    // in any order and on any thread, with no generator state to share.
+    constexpr std::uint32_t pcg_hash(std::uint32_t v) {
+        std::uint32_t state = v * 747796405u + 2891336453u;
+        std::uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    // Uniform float in [0, 1), from the top 24 bits of [h].
+    constexpr float unit_float(std::uint32_t h) {
+        return float(h >> 8) * (1.f / 16777216.f);
+    }
+}
@@ -0,0 +1,158 @@
+//===--------------------------------------------------------------------------------------------===
+// hierarchy.cpp - Parent/child transform hierarchies
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include "hierarchy.hpp"
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+namespace amyinorbit {
+    using ecs::Entity;
+    using ecs::Index;
+    using ecs::World;
+
+    namespace {
+        // Whether walking up the links from [from] reaches [target]. Gives up after as many steps
+        // as there are entities, in case the links already hold a cycle of their own.
+        [[maybe_unused]] bool reaches(World& world, Entity from, Entity target) {
+            auto entity = from;
+            for(Index steps = 0; steps <= world.size() && world.is_valid(entity); ++steps) {
+                if(entity.id == target.id) return true;
+                if(!world.has_component<Parent>(entity)) return false;
+                entity = world.read<const Parent>(entity).entity;
+            }
+            return false;
+        }
+    }
+
+    void attach(World& world, Entity child, Entity parent) {
+        assert(world.is_valid(child) && world.is_valid(parent));
+        assert(world.has_component<Transform>(child) && world.has_component<Transform>(parent));
+        assert(!reaches(world, parent, child) && "attaching would create a parent cycle");
+
+        if(world.has_component<Parent>(child)) {
+            world.set_component(child, Parent{parent});
+        } else {
+            world.add_component<Parent>(child, parent);
+        }
+        if(!world.has_component<WorldTransform>(child)) world.add_component<WorldTransform>(child);
+        if(!world.has_component<WorldTransform>(parent)) world.add_component<WorldTransform>(parent);
+    }
+
+    void detach(World& world, Entity child) {
+        assert(world.is_valid(child));
+        if(world.has_component<Parent>(child)) world.remove_component<Parent>(child);
+    }
+
+    bool TransformHierarchy::stale(World& world) const {
+        // Links added or retargeted since the last run?
+        for(const auto& item: world.with<ecs::Changed<const Parent>>(since_)) {
+            (void)item;
+            return true;
+        }
+        // Links removed: detach() only drops the Parent, which Changed<> cannot see.
+        if(world.count<Parent>() != links_) return true;
+        // Nodes added or removed: every node has a WorldTransform, and vice versa. Both checks
+        // are O(1), so a hierarchy that did not change costs nothing here.
+        if(world.count<WorldTransform>() != nodes_.size()) return true;
+        return world.removals<WorldTransform>() != removals_;
+    }
+
+    void TransformHierarchy::rebuild(World& world) {
+        std::unordered_map<Index, std::vector<Entity>> children;
+        links_ = 0;
+        removals_ = world.removals<WorldTransform>();
+        for(const auto& item: world.with<const Parent>()) {
+            links_ += 1;
+            auto parent = item.get<0>().entity;
+            if(world.is_valid(parent) && world.has_component<WorldTransform>(parent)) {
+                children[parent.id].push_back(item.entity());
+            }
+        }
+
+        // Roots are nodes without a (live) parent. Appending each node's children as it is
+        // visited gives a breadth-first, depth-sorted order.
+        nodes_.clear();
+        for(const auto& item: world.with<const WorldTransform>()) {
+            auto entity = item.entity();
+            if(world.has_component<Parent>(entity)) {
+                auto parent = world.read<const Parent>(entity).entity;
+                if(world.is_valid(parent) && world.has_component<WorldTransform>(parent)) continue;
+            }
+            nodes_.push_back(Node{entity, root});
+        }
+        std::vector<Index> depth(nodes_.size(), 0);
+        for(Index i = 0; i < nodes_.size(); ++i) {
+            auto it = children.find(nodes_[i].entity.id);
+            if(it == children.end()) continue;
+            for(auto child: it->second) {
+                nodes_.push_back(Node{child, i});
+                depth.push_back(depth[i] + 1);
+            }
+        }
+        // attach() asserts against cycles, but Parent can be set by hand: entities caught in a
+        // cycle are never reached from a root, so they are left out (and the hierarchy is rebuilt
+        // every frame until the cycle is broken).
+        sort_levels(depth);
+
+        matrices_.resize(nodes_.size());
+        dirty_.resize(nodes_.size());
+        rebuilt_ = true;
+    }
+
+    void TransformHierarchy::sort_levels(const std::vector<Index>& depth) {
+        // Within a depth, visit entities in id order, so that each level sweeps forward through
+        // the component stores. Parents are still remapped before their children.
+        const auto count = Index(nodes_.size());
+        std::vector<Index> remap(count);
+        std::vector<Index> level;
+        std::vector<Node> sorted;
+        sorted.reserve(count);
+        for(Index begin = 0, end = 0; begin < count; begin = end) {
+            while(end < count && depth[end] == depth[begin]) ++end;
+            level.resize(end - begin);
+            for(Index i = begin; i < end; ++i) level[i - begin] = i;
+            std::sort(level.begin(), level.end(), [&](Index a, Index b) {
+                return nodes_[a].entity.id < nodes_[b].entity.id;
+            });
+            for(auto i: level) {
+                auto node = nodes_[i];
+                if(node.parent != root) node.parent = remap[node.parent];
+                remap[i] = Index(sorted.size());
+                sorted.push_back(node);
+            }
+        }
+        nodes_.swap(sorted);
+    }
+
+    void TransformHierarchy::run(World& world, float) {
+        if(stale(world)) rebuild(world);
+
+        updated_ = 0;
+        const auto count = nodes_.size();
+        for(std::size_t i = 0; i < count; ++i) {
+            const auto& node = nodes_[i];
+            bool dirty = rebuilt_
+                || (node.parent != root && dirty_[node.parent])
+                || world.changed_since<Transform>(node.entity, since_);
+            dirty_[i] = dirty;
+            if(!dirty) continue;
+
+            // Transform is only read here, so its cached matrix must be left alone.
+            const auto local = world.read<const Transform>(node.entity).compute_transform();
+            matrices_[i] = node.parent == root ? local : matrices_[node.parent] * local;
+            world.get_component<WorldTransform>(node.entity).matrix = matrices_[i];
+            updated_ += 1;
+        }
+
+        // Writes made later in this tick are picked up again next run: a change may be propagated
+        // twice, but is never missed.
+        rebuilt_ = false;
+        since_ = world.tick();
+    }
+}
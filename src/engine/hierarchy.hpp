@@ -0,0 +1,62 @@
+//===--------------------------------------------------------------------------------------------===
+// hierarchy.hpp - Parent/child transform hierarchies
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <ecs/system.hpp>
+#include "components.hpp"
+
+namespace amyinorbit {
+
+    // Makes [child]'s Transform relative to [parent]'s. Both entities need a Transform, and get a
+    // WorldTransform if they do not have one yet. These are structural changes: from inside a
+    // system, record them with World::commands() instead.
+    void attach(ecs::World& world, ecs::Entity child, ecs::Entity parent);
+
+    // Makes [child] the root of its own subtree again.
+    void detach(ecs::World& world, ecs::Entity child);
+
+    // Computes WorldTransform for every entity in a hierarchy. Nodes are kept in breadth-first
+    // (depth-sorted) order, so one forward pass resolves each parent before its children and
+    // reads the node and matrix arrays sequentially. Each depth is sorted by entity id, so the
+    // Transform reads of a level move forward through the store. Only subtrees under a Transform
+    // that changed since the last run are recomputed; the order itself is rebuilt only when links
+    // change.
+    class TransformHierarchy
+        : public ecs::System<ecs::Reads<Transform, Parent>, ecs::Writes<WorldTransform>> {
+    public:
+        void run(ecs::World& world, float dt) override;
+
+        std::size_t size() const { return nodes_.size(); }
+        // Number of world matrices recomputed by the last run.
+        std::size_t updated() const { return updated_; }
+
+    private:
+        static constexpr ecs::Index root = ~ecs::Index(0);
+
+        struct Node {
+            ecs::Entity entity;
+            ecs::Index parent; // index in nodes_, or root
+        };
+
+        bool stale(ecs::World& world) const;
+        void rebuild(ecs::World& world);
+        void sort_levels(const std::vector<ecs::Index>& depth);
+
+        std::vector<Node> nodes_;
+        std::vector<mat4> matrices_;
+        std::vector<std::uint8_t> dirty_;
+        std::size_t links_ = 0; // Parent components seen by the last rebuild
+        std::uint64_t removals_ = 0; // world.removals<WorldTransform>() at the last rebuild
+
+        ecs::Tick since_ = 0;
+        bool rebuilt_ = false;
+        std::size_t updated_ = 0;
+    };
+}
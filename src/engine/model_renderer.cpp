@@ -12,8 +12,8 @@
 namespace amyinorbit {
     using namespace gl;
 
-    ModelRenderer::ModelRenderer(AssetsLib& assets, ecs::World& world)
-    : assets_(assets), ecs(world), offset_(0) {
+    ModelRenderer::ModelRenderer(AssetsLib& assets)
+    : assets_(assets), offset_(0) {
         std::cout << "[init] 3d model rendering module\n";
         vao_ = VertexArray(VertexArray::Desc{});
         vao_.bind();
@@ -60,7 +60,12 @@ namespace amyinorbit {
         return m;
     }
 
-    void ModelRenderer::render(const RenderData& data) {
+    std::uint32_t ModelRenderer::texture(const gl::Tex2D& texture) {
+        textures_.emplace(texture.id(), texture);
+        return texture.id();
+    }
+
+    void ModelRenderer::render(const RenderData& data, const RenderState::frame_type& frame) {
         // glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
         vao_.bind();
         shader_.bind();
@@ -73,13 +78,18 @@ namespace amyinorbit {
         shader_.set_uniform("proj", data.projection);
         shader_.set_uniform("view", data.view);
 
-        for(const auto& [model, transform]: ecs.with<Model, Transform>()) {
+        frame.each<Model>([&](ecs::Entity entity, const Model& model) {
+            const auto* transform = frame.find<Transform>(entity);
+            if(!transform) return;
             // std::cout << "rendering model at " << model.offset << "/" << model.vertices<< "\n";
-            model.texture.bind();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, model.texture);
 
-            shader_.set_uniform("model", transform.transform());
+            // Entities in a transform hierarchy carry their resolved world matrix.
+            const auto* world = frame.find<WorldTransform>(entity);
+            shader_.set_uniform("model", world ? world->matrix : transform->transform());
             shader_.set_uniform("blend", model.texture_blend);
             glDrawArrays(GL_TRIANGLES, model.offset, model.vertices);
-        }
+        });
     }
 }
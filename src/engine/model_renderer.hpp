@@ -7,7 +7,7 @@
 // =^•.•^=
 //===--------------------------------------------------------------------------------------------===
 #pragma once
-#include <ecs/world.hpp>
+#include <ecs/buffered.hpp>
 #include <glue/buffer.hpp>
 #include <glue/shaders.hpp>
 #include <glue/vertex_array.hpp>
@@ -17,6 +17,7 @@
 #include "assets_lib.hpp"
 #include "components.hpp"
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -24,21 +25,29 @@ namespace amyinorbit {
     using apm::vec3;
     using apm::matrix4;
 
+    // What an entity draws: a range of the renderer's vertex buffer, and the texture blended over
+    // it. Plain data, since the simulation thread copies it around: the GL objects themselves
+    // belong to the ModelRenderer, on the render thread.
     struct Model {
-        std::uint32_t offset;
-        std::uint32_t vertices;
-        gl::Tex2D texture;
+        std::uint32_t offset = 0;
+        std::uint32_t vertices = 0;
+        std::uint32_t texture = 0; // GL name, from ModelRenderer::texture()
         float texture_blend = 0.f;
     };
 
+    // What the renderer reads from the simulation. The world itself belongs to the simulation
+    // thread, so rendering only ever sees the last published copy of these components.
+    using RenderState = ecs::FrameState<Model, Transform, WorldTransform>;
+
     class ModelRenderer {
     public:
-        ModelRenderer(AssetsLib& assets, ecs::World& world);
+        ModelRenderer(AssetsLib& assets);
         Model model(const std::string& path);
-        void render(const RenderData& data);
+        // Keeps [texture] alive for as long as the renderer, and returns its name for Model.
+        std::uint32_t texture(const gl::Tex2D& texture);
+        void render(const RenderData& data, const RenderState::frame_type& frame);
     private:
         AssetsLib& assets_;
-        ecs::World& ecs;
         std::size_t offset_ = 0;
 
         gl::Buffer vbo_;
@@ -46,5 +55,8 @@ namespace amyinorbit {
         gl::Shader shader_;
 
         std::unordered_map<std::string, Model> models_;
+        std::unordered_map<std::uint32_t, gl::Tex2D> textures_;
     };
 }
+
+ECS_COMPONENT(amyinorbit::Model, 1);
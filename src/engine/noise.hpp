@@ -10,26 +10,99 @@
 #include <glue/glue.hpp>
 #include <apmath/math.hpp>
 #include <apmath/vector.hpp>
+#include <ecs/thread_pool.hpp>
+#include <vector>
 #include "SimplexNoise.h"
 #include "worley.hpp"
 
 namespace amyinorbit {
+
+    // Textures are generated a z-slab (or, in 2D, a row) at a time, with slabs spread over [pool]
+    // and each one filled in memory order. Every texel only depends on its own coordinates, so
+    // the result is bit-for-bit the same as a serial fill (pool == nullptr) on any thread count.
+    // Simplex noise is evaluated a row at a time with the batched, vectorised SimplexNoise calls.
+    // The same [seed] always gives the same texels; 0 is the classic simplex permutation.
     class Noise {
     public:
         using u32 = std::uint32_t;
+        using Pool = ecs::ThreadPool;
 
-        static inline gl::Tex2D perlin(const apm::uvec2& res, const apm::vec2& size, float freq) {
-            auto h = size / apm::vec2(res);
+        static constexpr u32 perlin_octaves_2d = 8;
+        static constexpr u32 perlin_octaves_3d = 5;
+
+        static inline gl::Tex2D perlin(const apm::uvec2& res, const apm::vec2& size, float freq,
+                                       u32 seed = 0, Pool* pool = &Pool::shared()) {
+            float* data = alloc_data(res);
+            bake_perlin(data, res, size, freq, seed, pool);
+            auto tex = texture(res, data);
+            delete [] data;
+            return tex;
+        }
+
+        static inline gl::Tex3D perlin(const apm::uvec3& res, const apm::vec3& size, float freq,
+                                       u32 seed = 0, Pool* pool = &Pool::shared()) {
             float* data = alloc_data(res);
+            bake_perlin(data, res, size, freq, seed, pool);
+            auto tex = texture(res, data);
+            delete [] data;
+            return tex;
+        }
+
+        static inline gl::Tex3D p_worley(const apm::uvec3& res, const apm::vec3& size, float freq,
+                                         u32 seed = 0, Pool* pool = &Pool::shared()) {
+            float* data = alloc_data(res);
+            bake_worley(data, res, size, freq, seed, pool);
+            auto tex = texture(res, data);
+            delete [] data;
+            return tex;
+        }
 
-            SimplexNoise gen(freq); // Judge Gen Ahoy!
-            for(u32 i = 0; i < res.w; ++i) {
-                for(u32 j = 0; j < res.h; ++j) {
-                    auto r = apm::vec2(i,j) * h;
-                    auto index = (j*res.w) + i;
-                    data[index] = apm::remap(gen.fractal(8, r.x, r.y), -1.f, 1.f, 0.f, 1.f);
+        // The texels alone, one float each in x-major order, for callers that keep them around
+        // (see NoiseCache).
+        static inline void bake_perlin(float* data, const apm::uvec2& res, const apm::vec2& size,
+                                       float freq, u32 seed = 0,
+                                       Pool* pool = &Pool::shared()) {
+            auto h = size / apm::vec2(res);
+            SimplexNoise gen(freq, 1.f, 2.f, 0.5f, seed); // Judge Gen Ahoy!
+            fill(data, res, pool, [&](float* row, u32 j) {
+                auto& r = coords(res.w, j * h.y);
+                for(u32 i = 0; i < res.w; ++i) r.x[i] = i * h.x;
+                gen.fractal(perlin_octaves_2d, r.x.data(), r.y.data(), row, res.w);
+                for(u32 i = 0; i < res.w; ++i) row[i] = apm::remap(row[i], -1.f, 1.f, 0.f, 1.f);
+            });
+        }
+
+        static inline void bake_perlin(float* data, const apm::uvec3& res, const apm::vec3& size,
+                                       float freq, u32 seed = 0,
+                                       Pool* pool = &Pool::shared()) {
+            auto h = size / apm::vec3(res);
+            SimplexNoise gen(freq, 1.f, 2.f, 0.5f, seed); // Judge Gen Ahoy!
+            fill(data, res, pool, [&](float* row, u32 j, u32 k) {
+                auto& r = coords(res.x, j * h.y, k * h.z);
+                for(u32 i = 0; i < res.x; ++i) r.x[i] = i * h.x;
+                gen.fractal(perlin_octaves_3d, r.x.data(), r.y.data(), r.z.data(), row, res.x);
+                for(u32 i = 0; i < res.x; ++i) row[i] = apm::remap(row[i], -1.f, 1.f, 0.f, 1.f);
+            });
+        }
+
+        static inline void bake_worley(float* data, const apm::uvec3& res, const apm::vec3& size,
+                                       float freq, u32 seed = 0,
+                                       Pool* pool = &Pool::shared()) {
+            auto h = size / apm::vec3(res);
+            const WorleyNoise<3> gen_w(size, freq, seed);
+
+            // SimplexNoise gen_p(freq); // Judge Gen Ahoy!
+            fill(data, res, pool, [&](float* row, u32 j, u32 k) {
+                for(u32 i = 0; i < res.x; ++i) {
+                    auto r = apm::vec3(i,j,k) * h;
+                    float v = gen_w(r);
+                    row[i] = v;//apm::remap(v, 0.f, 1.f, 0.f, 1.f);
                 }
-            }
+            });
+        }
+
+        // Single-channel float textures that repeat, with linear filtering and mipmaps.
+        static inline gl::Tex2D texture(const apm::uvec2& res, const float* data) {
             gl::Tex2D::Desc<float> desc;
             desc.source_format = gl::TexFormat::red;
             desc.dest_format = gl::TexFormat::red;
@@ -39,69 +112,66 @@ namespace amyinorbit {
             tex.set_wrap(gl::Wrap::repeat, gl::Wrap::repeat);
             tex.set_mag_filter(gl::Filter::linear);
             tex.gen_mipmaps();
-            delete data;
             return tex;
         }
 
-        static inline gl::Tex3D perlin(const apm::uvec3& res, const apm::vec3& size, float freq) {
-            auto h = size / apm::vec3(res);
-            float* data = alloc_data(res);
-
-            SimplexNoise gen(freq); // Judge Gen Ahoy!
-            for(u32 i = 0; i < res.x; ++i) {
-                for(u32 j = 0; j < res.y; ++j) {
-                    for(u32 k = 0; k < res.z; ++k) {
-                        auto r = apm::vec3(i,j,k) * h;
-                        auto index = (k*res.x*res.y) + (j*res.x) + i;
-                        data[index] = apm::remap(gen.fractal(5, r.x, r.y, r.z),
-                            -1.f, 1.f, 0.f, 1.f);
-                    }
-                }
-            }
+        static inline gl::Tex3D texture(const apm::uvec3& res, const float* data) {
             gl::Tex3D::Desc<float> desc;
             desc.source_format = gl::TexFormat::red;
             desc.dest_format = gl::TexFormat::red;
             desc.size = res;
-
             gl::Tex3D tex(desc, data);
             tex.bind();
             tex.set_wrap(gl::Wrap::repeat, gl::Wrap::repeat, gl::Wrap::repeat);
             tex.set_mag_filter(gl::Filter::linear);
             tex.gen_mipmaps();
-            delete data;
             return tex;
         }
 
-        static inline gl::Tex3D p_worley(const apm::uvec3& res, const apm::vec3& size, float freq) {
-            auto h = size / apm::vec3(res);
-            float* data = alloc_data(res);
-            WorleyNoise<3> gen_w(size, freq);
+    private:
+        // Per-thread coordinate arrays for one row of texels: x varies along the row, y and z
+        // are constant.
+        struct Coords {
+            std::vector<float> x, y, z;
+        };
 
-            // SimplexNoise gen_p(freq); // Judge Gen Ahoy!
-            for(u32 i = 0; i < res.x; ++i) {
-                for(u32 j = 0; j < res.y; ++j) {
-                    for(u32 k = 0; k < res.z; ++k) {
-                        auto r = apm::vec3(i,j,k) * h;
-                        auto index = (k*res.x*res.y) + (j*res.x) + i;
-                        float v = gen_w(r);
-                        data[index] = v;//apm::remap(v, 0.f, 1.f, 0.f, 1.f);
-                    }
+        static Coords& coords(u32 width, float y, float z = 0.f) {
+            thread_local Coords r;
+            r.x.resize(width);
+            r.y.assign(width, y);
+            r.z.assign(width, z);
+            return r;
+        }
+
+        // Calls fill_row(row, j) for every row of a [res] texture, one row per task.
+        template <typename F>
+        static void fill(float* data, const apm::uvec2& res, Pool* pool, const F& fill_row) {
+            auto rows = [&](ecs::Index from, ecs::Index to) {
+                for(u32 j = from; j < to; ++j) fill_row(data + std::size_t(j) * res.w, j);
+            };
+            if(pool) {
+                pool->parallel_for(0, res.h, 1, rows);
+            } else {
+                rows(0, res.h);
+            }
+        }
+
+        // Calls fill_row(row, j, k) for every row of a [res] volume, one z-slab per task.
+        template <typename F>
+        static void fill(float* data, const apm::uvec3& res, Pool* pool, const F& fill_row) {
+            auto slabs = [&](ecs::Index from, ecs::Index to) {
+                for(u32 k = from; k < to; ++k) {
+                    float* slab = data + std::size_t(k) * res.x * res.y;
+                    for(u32 j = 0; j < res.y; ++j) fill_row(slab + std::size_t(j) * res.x, j, k);
                 }
+            };
+            if(pool) {
+                pool->parallel_for(0, res.z, 1, slabs);
+            } else {
+                slabs(0, res.z);
             }
-            gl::Tex3D::Desc<float> desc;
-            desc.source_format = gl::TexFormat::red;
-            desc.dest_format = gl::TexFormat::red;
-            desc.size = res;
-            gl::Tex3D tex(desc, data);
-            tex.bind();
-            tex.set_wrap(gl::Wrap::repeat, gl::Wrap::repeat, gl::Wrap::repeat);
-            tex.set_mag_filter(gl::Filter::linear);
-            tex.gen_mipmaps();
-            delete data;
-            return tex;
         }
 
-    private:
         template <int C>
         static float* alloc_data(const apm::vec<u32, C>& sv) {
             return new float[size(sv)];
@@ -0,0 +1,189 @@
+//===--------------------------------------------------------------------------------------------===
+// noise_cache.cpp - On-disk cache for baked noise textures
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include "noise_cache.hpp"
+#include "noise.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+namespace amyinorbit {
+
+    namespace {
+        constexpr std::uint32_t cache_magic = 0x45534e54; // "TNSE"
+
+        // A cache file is this header, then key.res[0] * key.res[1] * key.res[2] floats.
+        struct Header {
+            std::uint32_t magic;
+            std::uint32_t version;
+            NoiseCache::Key key;
+            std::uint64_t texels;
+        };
+        static_assert(std::is_trivially_copyable_v<Header>);
+        static_assert(sizeof(NoiseCache::Key) == 40, "keys are compared and hashed as raw bytes");
+        static_assert(sizeof(Header) % alignof(float) == 0);
+
+        std::uint64_t hash(const NoiseCache::Key& key) {
+            auto bytes = reinterpret_cast<const unsigned char*>(&key);
+            std::uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+            for(std::size_t i = 0; i < sizeof(key); ++i) {
+                h = (h ^ bytes[i]) * 0x100000001b3ull;
+            }
+            return h;
+        }
+
+        const char* kind_name(NoiseCache::Kind kind) {
+            switch(kind) {
+            case NoiseCache::Kind::perlin2d: return "perlin2d";
+            case NoiseCache::Kind::perlin3d: return "perlin3d";
+            case NoiseCache::Kind::worley3d: return "worley3d";
+            }
+            return "noise";
+        }
+
+        std::size_t texel_count(const NoiseCache::Key& key) {
+            return std::size_t(key.res[0]) * key.res[1] * key.res[2];
+        }
+
+        // Writes to a temporary file first, so that an interrupted bake never leaves a truncated
+        // file behind under the real name.
+        bool store(const std::string& dir, const std::string& path, const NoiseCache::Key& key,
+                   const std::vector<float>& texels) {
+            std::error_code error;
+            std::filesystem::create_directories(dir, error);
+            if(error) return false;
+
+            auto temp = path + ".tmp";
+            auto file = std::fopen(temp.c_str(), "wb");
+            if(!file) return false;
+
+            Header header;
+            std::memset(&header, 0, sizeof(header));
+            header.magic = cache_magic;
+            header.version = NoiseCache::version;
+            header.key = key;
+            header.texels = texels.size();
+
+            bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+                && std::fwrite(texels.data(), sizeof(float), texels.size(), file) == texels.size();
+            ok = std::fclose(file) == 0 && ok;
+            if(ok) ok = std::rename(temp.c_str(), path.c_str()) == 0;
+            if(!ok) std::remove(temp.c_str());
+            return ok;
+        }
+    }
+
+    // Read-only mapping of a cache file, if it exists and holds the texels for the key.
+    class NoiseCache::Texels {
+    public:
+        Texels(const std::string& path, const Key& key) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0) return;
+            struct stat info;
+            if(::fstat(fd, &info) == 0 && std::size_t(info.st_size) >= sizeof(Header)) {
+                size_ = info.st_size;
+                auto ptr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(ptr != MAP_FAILED) map_ = ptr;
+            }
+            ::close(fd);
+            if(!map_) return;
+
+            const auto& header = *static_cast<const Header*>(map_);
+            auto count = texel_count(key);
+            if(header.magic != cache_magic || header.version != version) return;
+            if(std::memcmp(&header.key, &key, sizeof(Key)) || header.texels != count) return;
+            if(size_ != sizeof(Header) + count * sizeof(float)) return;
+            data_ = reinterpret_cast<const float*>(static_cast<const char*>(map_) + sizeof(Header));
+        }
+
+        ~Texels() {
+            if(map_) ::munmap(map_, size_);
+        }
+
+        Texels(const Texels&) = delete;
+        Texels& operator=(const Texels&) = delete;
+
+        const float* data() const { return data_; }
+
+    private:
+        void* map_ = nullptr;
+        std::size_t size_ = 0;
+        const float* data_ = nullptr;
+    };
+
+    std::string NoiseCache::path(const Key& key) const {
+        char name[64];
+        std::snprintf(name, sizeof(name), "/%s-%016llx.bin", kind_name(key.kind),
+                      (unsigned long long)hash(key));
+        return dir_ + name;
+    }
+
+    template <typename Tex>
+    Tex NoiseCache::load(const Key& key, const std::function<void(float*)>& bake,
+                         const std::function<Tex(const float*)>& upload) {
+        auto file = path(key);
+        if(!rebake_) {
+            Texels texels(file, key);
+            if(texels.data()) return upload(texels.data());
+        }
+
+        using namespace std::chrono;
+        auto start = steady_clock::now();
+        std::vector<float> texels(texel_count(key));
+        bake(texels.data());
+        auto ms = duration_cast<milliseconds>(steady_clock::now() - start).count();
+
+        if(store(dir_, file, key, texels)) {
+            std::cout << "[init] baked " << file << " in " << ms << "ms\n";
+        } else {
+            std::cerr << "cannot write noise cache " << file << "\n";
+        }
+        return upload(texels.data());
+    }
+
+    gl::Tex2D NoiseCache::perlin(const apm::uvec2& res, const apm::vec2& size, float freq,
+                                 u32 seed) {
+        const Key key{
+            Kind::perlin2d, {res.x, res.y, 1}, {size.x, size.y, 0.f},
+            freq, Noise::perlin_octaves_2d, seed
+        };
+        return load<gl::Tex2D>(key,
+            [&](float* data) { Noise::bake_perlin(data, res, size, freq, seed); },
+            [&](const float* data) { return Noise::texture(res, data); });
+    }
+
+    gl::Tex3D NoiseCache::perlin(const apm::uvec3& res, const apm::vec3& size, float freq,
+                                 u32 seed) {
+        const Key key{
+            Kind::perlin3d, {res.x, res.y, res.z}, {size.x, size.y, size.z},
+            freq, Noise::perlin_octaves_3d, seed
+        };
+        return load<gl::Tex3D>(key,
+            [&](float* data) { Noise::bake_perlin(data, res, size, freq, seed); },
+            [&](const float* data) { return Noise::texture(res, data); });
+    }
+
+    gl::Tex3D NoiseCache::p_worley(const apm::uvec3& res, const apm::vec3& size, float freq,
+                                   u32 seed) {
+        const Key key{
+            Kind::worley3d, {res.x, res.y, res.z}, {size.x, size.y, size.z},
+            freq, 0, seed
+        };
+        return load<gl::Tex3D>(key,
+            [&](float* data) { Noise::bake_worley(data, res, size, freq, seed); },
+            [&](const float* data) { return Noise::texture(res, data); });
+    }
+}
@@ -0,0 +1,64 @@
+//===--------------------------------------------------------------------------------------------===
+// noise_cache.hpp - On-disk cache for baked noise textures
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <glue/glue.hpp>
+#include <apmath/vector.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace amyinorbit {
+
+    // Keeps the texels of every noise texture it bakes in [dir], one file per generator and set
+    // of parameters, and maps them straight back in on later runs instead of baking again. Files
+    // from another version of the format or of the generators are ignored and rebaked.
+    class NoiseCache {
+    public:
+        using u32 = std::uint32_t;
+
+        // Bump whenever the format, or the output of a generator, changes.
+        static constexpr u32 version = 2;
+
+        enum class Kind : u32 { perlin2d = 1, perlin3d = 2, worley3d = 3 };
+
+        // Everything a baked texture depends on. Unused dimensions are 1 (res) and 0 (size).
+        struct Key {
+            Kind kind;
+            u32 res[3];
+            float size[3];
+            float freq;
+            u32 octaves;
+            u32 seed;
+        };
+
+        // With [rebake], every texture is generated again and its file rewritten.
+        explicit NoiseCache(const std::string& dir, bool rebake = false)
+            : dir_(dir), rebake_(rebake) {}
+
+        gl::Tex2D perlin(const apm::uvec2& res, const apm::vec2& size, float freq, u32 seed = 0);
+        gl::Tex3D perlin(const apm::uvec3& res, const apm::vec3& size, float freq, u32 seed = 0);
+        gl::Tex3D p_worley(const apm::uvec3& res, const apm::vec3& size, float freq,
+                           u32 seed = 0);
+
+        // cache/noise/perlin3d-0123456789abcdef.bin
+        std::string path(const Key& key) const;
+
+    private:
+        class Texels;
+
+        // Maps the texels for [key] from disk, calling bake() to generate (and store) them first
+        // when there is no usable file. Hands them to upload() while they are mapped.
+        template <typename Tex>
+        Tex load(const Key& key, const std::function<void(float*)>& bake,
+                 const std::function<Tex(const float*)>& upload);
+
+        std::string dir_;
+        bool rebake_;
+    };
+}
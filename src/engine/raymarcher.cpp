@@ -7,15 +7,14 @@
 // =^•.•^=
 //===--------------------------------------------------------------------------------------------===
 #include "raymarcher.hpp"
-#include "noise.hpp"
 #include "scene3d.hpp"
 
 namespace amyinorbit {
     using namespace gl;
 
     RayMarcher::RayMarcher(AssetsLib& assets) {
-        noise_ = Noise::perlin(apm::uvec3(grid), apm::vec3(10.f), 1.f);
-        clouds_ = Noise::perlin(apm::uvec2(1024, 1024), apm::vec2(10.f), 0.1f);
+        noise_ = assets.noise().perlin(apm::uvec3(grid), apm::vec3(10.f), 1.f);
+        clouds_ = assets.noise().perlin(apm::uvec2(1024, 1024), apm::vec2(10.f), 0.1f);
         // clouds_.set_wrap(Wrap::clamp_edge, Wrap::clamp_edge);
     }
 
@@ -0,0 +1,46 @@
+//===--------------------------------------------------------------------------------------------===
+// simplex_batch.hpp - Vectorised kernels for batched simplex noise
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Each instruction set lives in its own translation unit, built with the matching -m flags, so
+// that one kernel template can be compiled for every vector width. The build defines
+// THERMALS_SIMPLEX_SIMD when it compiles those units (x86 with GCC or Clang only).
+#ifndef THERMALS_SIMPLEX_SIMD
+#define THERMALS_SIMPLEX_SIMD 0
+#endif
+
+namespace amyinorbit::simplex {
+
+    // Octave parameters of a batch. Plain noise is one octave at frequency and amplitude 1.
+    struct Fbm {
+        std::size_t octaves;
+        float frequency;
+        float amplitude;
+        float lacunarity;
+        float persistence;
+    };
+
+    // [perm] is the noise's 256-entry permutation table, widened to 32 bits for gathers.
+#if THERMALS_SIMPLEX_SIMD
+    void fractal_sse41(const std::int32_t* perm, const Fbm& fbm, const float* x, const float* y,
+                       float* out, std::size_t count);
+    void fractal_sse41(const std::int32_t* perm, const Fbm& fbm, const float* x, const float* y,
+                       const float* z, float* out, std::size_t count);
+    void fractal_avx2(const std::int32_t* perm, const Fbm& fbm, const float* x, const float* y,
+                      float* out, std::size_t count);
+    void fractal_avx2(const std::int32_t* perm, const Fbm& fbm, const float* x, const float* y,
+                      const float* z, float* out, std::size_t count);
+    void fractal_avx512(const std::int32_t* perm, const Fbm& fbm, const float* x, const float* y,
+                        float* out, std::size_t count);
+    void fractal_avx512(const std::int32_t* perm, const Fbm& fbm, const float* x, const float* y,
+                        const float* z, float* out, std::size_t count);
+#endif
+}
@@ -0,0 +1,225 @@
+//===--------------------------------------------------------------------------------------------===
+// simplex_batch.inl - Simplex noise kernel, generic over the vector width
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+// Included once by each per-instruction-set unit, which decides the width. The kernels follow
+// SimplexNoise.cpp operation for operation (same constants, same evaluation order, branches
+// turned into masks), so with contraction off they round exactly like the scalar code.
+#include "simplex_batch.hpp"
+#include <climits>
+#include <cstring>
+#include <immintrin.h>
+
+namespace amyinorbit::simplex {
+    namespace {
+
+        // GCC ignores vector_size on dependent types, so each width is spelled out.
+        template <int W>
+        struct Vectors;
+
+        template <>
+        struct Vectors<4> {
+            typedef float Float __attribute__((vector_size(16)));
+            typedef std::int32_t Int __attribute__((vector_size(16)));
+        };
+
+        template <>
+        struct Vectors<8> {
+            typedef float Float __attribute__((vector_size(32)));
+            typedef std::int32_t Int __attribute__((vector_size(32)));
+        };
+
+        template <>
+        struct Vectors<16> {
+            typedef float Float __attribute__((vector_size(64)));
+            typedef std::int32_t Int __attribute__((vector_size(64)));
+        };
+
+        // The simplex noise functions over W points at a time.
+        template <int W>
+        struct Kernel {
+            using Float = typename Vectors<W>::Float;
+            using Int = typename Vectors<W>::Int;
+
+            static Float to_float(Int v) { return __builtin_convertvector(v, Float); }
+
+            // Comparisons give all-ones lanes where true, so adding one subtracts 1 where
+            // x < (int)x.
+            static Int fastfloor(Float x) {
+                auto i = __builtin_convertvector(x, Int);
+                return i + (x < to_float(i));
+            }
+
+            static Float select(Int mask, Float a, Float b) {
+                return (Float)((mask & (Int)a) | (~mask & (Int)b));
+            }
+
+            static Float negate_if(Int mask, Float v) {
+                return (Float)((Int)v ^ (mask & INT_MIN));
+            }
+
+            // perm[index & 255] in every lane.
+            static Int hash(const std::int32_t* perm, Int index) {
+                index &= 0xff;
+#if defined(__AVX512F__)
+                if constexpr(W == 16) {
+                    // The unmasked gather leaves its pass-through source undefined, which GCC 12
+                    // reports as uninitialised: spell out a zero source and a full mask instead.
+                    return (Int)_mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff,
+                                                            (__m512i)index, perm, 4);
+                }
+#endif
+#if defined(__AVX2__)
+                if constexpr(W == 8) {
+                    return (Int)_mm256_i32gather_epi32(perm, (__m256i)index, 4);
+                }
+#endif
+                Int out;
+                for(int l = 0; l < W; ++l) out[l] = perm[index[l]];
+                return out;
+            }
+
+            static Float grad(Int hash, Float x, Float y) {
+                auto h = hash & 0x3f;
+                auto low = h < 4;
+                auto u = select(low, x, y);
+                auto v = select(low, y, x);
+                return negate_if((h & 1) != 0, u) + negate_if((h & 2) != 0, 2.0f * v);
+            }
+
+            static Float grad(Int hash, Float x, Float y, Float z) {
+                auto h = hash & 15;
+                auto u = select(h < 8, x, y);
+                auto v = select(h < 4, y, select((h == 12) | (h == 14), x, z));
+                return negate_if((h & 1) != 0, u) + negate_if((h & 2) != 0, v);
+            }
+
+            // t^4 * g where t >= 0, +0 elsewhere.
+            static Float falloff(Float t, Float g) {
+                auto inside = ~(t < 0.0f);
+                t *= t;
+                return (Float)(inside & (Int)(t * t * g));
+            }
+
+            static Float noise(const std::int32_t* perm, Float x, Float y) {
+                constexpr float F2 = 0.366025403f;
+                constexpr float G2 = 0.211324865f;
+
+                const auto s = (x + y) * F2;
+                const auto i = fastfloor(x + s);
+                const auto j = fastfloor(y + s);
+
+                const auto t = to_float(i + j) * G2;
+                const auto x0 = x - (to_float(i) - t);
+                const auto y0 = y - (to_float(j) - t);
+
+                // Lower triangle (x0 > y0) steps through (1, 0), upper through (0, 1).
+                const Int lower = x0 > y0;
+                const Int i1 = lower & 1;
+                const Int j1 = ~lower & 1;
+
+                const auto x1 = x0 - to_float(i1) + G2;
+                const auto y1 = y0 - to_float(j1) + G2;
+                const auto x2 = x0 - 1.0f + 2.0f * G2;
+                const auto y2 = y0 - 1.0f + 2.0f * G2;
+
+                const auto gi0 = hash(perm, i + hash(perm, j));
+                const auto gi1 = hash(perm, i + i1 + hash(perm, j + j1));
+                const auto gi2 = hash(perm, i + 1 + hash(perm, j + 1));
+
+                const auto n0 = falloff(0.5f - x0*x0 - y0*y0, grad(gi0, x0, y0));
+                const auto n1 = falloff(0.5f - x1*x1 - y1*y1, grad(gi1, x1, y1));
+                const auto n2 = falloff(0.5f - x2*x2 - y2*y2, grad(gi2, x2, y2));
+                return 45.23065f * (n0 + n1 + n2);
+            }
+
+            static Float noise(const std::int32_t* perm, Float x, Float y, Float z) {
+                constexpr float F3 = 1.0f / 3.0f;
+                constexpr float G3 = 1.0f / 6.0f;
+
+                const auto s = (x + y + z) * F3;
+                const auto i = fastfloor(x + s);
+                const auto j = fastfloor(y + s);
+                const auto k = fastfloor(z + s);
+
+                const auto t = to_float(i + j + k) * G3;
+                const auto x0 = x - (to_float(i) - t);
+                const auto y0 = y - (to_float(j) - t);
+                const auto z0 = z - (to_float(k) - t);
+
+                // The scalar if-ladder's six rank orderings, as 0/1 corner offsets. The second
+                // corner has one offset set, the third has two.
+                const Int xy = x0 >= y0;
+                const Int yz = y0 >= z0;
+                const Int xz = x0 >= z0;
+                const Int i1 = xy & (yz | xz) & 1;
+                const Int j1 = ~xy & yz & 1;
+                const Int k1 = 1 - i1 - j1;
+                const Int i2 = (xy | (yz & xz)) & 1;
+                const Int j2 = (~xy | yz) & 1;
+                const Int k2 = 2 - i2 - j2;
+
+                const auto x1 = x0 - to_float(i1) + G3;
+                const auto y1 = y0 - to_float(j1) + G3;
+                const auto z1 = z0 - to_float(k1) + G3;
+                const auto x2 = x0 - to_float(i2) + 2.0f * G3;
+                const auto y2 = y0 - to_float(j2) + 2.0f * G3;
+                const auto z2 = z0 - to_float(k2) + 2.0f * G3;
+                const auto x3 = x0 - 1.0f + 3.0f * G3;
+                const auto y3 = y0 - 1.0f + 3.0f * G3;
+                const auto z3 = z0 - 1.0f + 3.0f * G3;
+
+                const auto gi0 = hash(perm, i + hash(perm, j + hash(perm, k)));
+                const auto gi1 = hash(perm, i + i1 + hash(perm, j + j1 + hash(perm, k + k1)));
+                const auto gi2 = hash(perm, i + i2 + hash(perm, j + j2 + hash(perm, k + k2)));
+                const auto gi3 = hash(perm, i + 1 + hash(perm, j + 1 + hash(perm, k + 1)));
+
+                const auto n0 = falloff(0.6f - x0*x0 - y0*y0 - z0*z0, grad(gi0, x0, y0, z0));
+                const auto n1 = falloff(0.6f - x1*x1 - y1*y1 - z1*z1, grad(gi1, x1, y1, z1));
+                const auto n2 = falloff(0.6f - x2*x2 - y2*y2 - z2*z2, grad(gi2, x2, y2, z2));
+                const auto n3 = falloff(0.6f - x3*x3 - y3*y3 - z3*z3, grad(gi3, x3, y3, z3));
+                return 32.0f * (n0 + n1 + n2 + n3);
+            }
+
+            template <typename... Coords>
+            static Float fractal(const std::int32_t* perm, const Fbm& fbm, Coords... coords) {
+                Float output = {};
+                float denom = 0.f;
+                float frequency = fbm.frequency;
+                float amplitude = fbm.amplitude;
+                for(std::size_t o = 0; o < fbm.octaves; ++o) {
+                    output += amplitude * noise(perm, (coords * frequency)...);
+                    denom += amplitude;
+                    frequency *= fbm.lacunarity;
+                    amplitude *= fbm.persistence;
+                }
+                return output / denom;
+            }
+
+            // fBm over [count] points, W at a time. The last block is padded with zeroes.
+            template <typename... Coords>
+            static void run(const std::int32_t* perm, const Fbm& fbm, float* out,
+                            std::size_t count, const Coords*... coords) {
+                std::size_t at = 0;
+                for(; at + W <= count; at += W) {
+                    auto v = fractal(perm, fbm, load(coords + at, W)...);
+                    std::memcpy(out + at, &v, sizeof(v));
+                }
+                if(at < count) {
+                    auto v = fractal(perm, fbm, load(coords + at, count - at)...);
+                    std::memcpy(out + at, &v, (count - at) * sizeof(float));
+                }
+            }
+
+            static Float load(const float* src, std::size_t count) {
+                Float v = {};
+                std::memcpy(&v, src, count * sizeof(float));
+                return v;
+            }
+        };
+    }
+}
@@ -0,0 +1,22 @@
+//===--------------------------------------------------------------------------------------------===
+// simplex_batch_sse41.cpp - SSE4.1 kernels for batched simplex noise
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include "simplex_batch.inl"
+
+namespace amyinorbit::simplex {
+
+    void fractal_sse41(const std::int32_t* perm, const Fbm& fbm, const float* x, const float* y,
+                       float* out, std::size_t count) {
+        Kernel<4>::run(perm, fbm, out, count, x, y);
+    }
+
+    void fractal_sse41(const std::int32_t* perm, const Fbm& fbm, const float* x, const float* y,
+                       const float* z, float* out, std::size_t count) {
+        Kernel<4>::run(perm, fbm, out, count, x, y, z);
+    }
+}
@@ -0,0 +1,49 @@
+//===--------------------------------------------------------------------------------------------===
+// simulation.cpp - Fixed-rate simulation thread
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include "simulation.hpp"
+#include <chrono>
+
+namespace amyinorbit {
+    using Clock = std::chrono::steady_clock;
+
+    Simulation::Simulation(double rate, Step step, int max_catch_up)
+        : rate_(rate)
+        , step_(std::move(step))
+        , max_catch_up_(max_catch_up)
+        , thread_([this] { loop(); }) {}
+
+    Simulation::~Simulation() {
+        stop();
+    }
+
+    void Simulation::stop() {
+        running_.store(false);
+        if(thread_.joinable()) thread_.join();
+    }
+
+    void Simulation::loop() {
+        const auto period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / rate_));
+        const float dt = float(1.0 / rate_);
+        auto next = Clock::now();
+
+        while(running_.load()) {
+            int behind = 0;
+            while(Clock::now() >= next && behind < max_catch_up_ && running_.load()) {
+                step_(dt);
+                steps_.fetch_add(1, std::memory_order_relaxed);
+                next += period;
+                behind += 1;
+            }
+            // Still behind after catching up: drop the missed steps.
+            if(behind == max_catch_up_) next = Clock::now() + period;
+            std::this_thread::sleep_until(next);
+        }
+    }
+}
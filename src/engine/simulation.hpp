@@ -0,0 +1,44 @@
+//===--------------------------------------------------------------------------------------------===
+// simulation.hpp - Fixed-rate simulation thread
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace amyinorbit {
+
+    // Calls [step] on its own thread [rate] times per second with a fixed time step, until
+    // stopped. When a step runs late the thread catches up without sleeping, but never runs more
+    // than [max_catch_up] steps in a row, so a stall does not turn into a spiral.
+    class Simulation {
+    public:
+        using Step = std::function<void(float dt)>;
+
+        Simulation(double rate, Step step, int max_catch_up = 5);
+        ~Simulation();
+        Simulation(const Simulation&) = delete;
+        Simulation& operator=(const Simulation&) = delete;
+
+        // Blocks until the current step is done and the thread has exited. Idempotent.
+        void stop();
+
+        std::uint64_t steps() const { return steps_.load(std::memory_order_relaxed); }
+
+    private:
+        void loop();
+
+        double rate_;
+        Step step_;
+        int max_catch_up_;
+        std::atomic<bool> running_{true};
+        std::atomic<std::uint64_t> steps_{0};
+        std::thread thread_;
+    };
+}
@@ -0,0 +1,77 @@
+//===--------------------------------------------------------------------------------------------===
+// telemetry_panel.cpp - ImGui view of ECS telemetry
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include "telemetry_panel.hpp"
+#include "../imgui/imgui.h"
+
+namespace amyinorbit {
+    using namespace ecs::telemetry;
+
+#if ECS_TELEMETRY
+    namespace {
+        void timings(const Monitor& monitor) {
+            ImGui::Columns(6, "timings");
+            ImGui::Text("kind"); ImGui::NextColumn();
+            ImGui::Text("name"); ImGui::NextColumn();
+            ImGui::Text("last ms"); ImGui::NextColumn();
+            ImGui::Text("avg ms"); ImGui::NextColumn();
+            ImGui::Text("max ms"); ImGui::NextColumn();
+            ImGui::Text("entities"); ImGui::NextColumn();
+            ImGui::Separator();
+            for(const auto& s: monitor.series()) {
+                if(s.kind == Kind::store) continue;
+                ImGui::Text("%s", kind_name(s.kind)); ImGui::NextColumn();
+                ImGui::Text("%s", s.name.c_str()); ImGui::NextColumn();
+                ImGui::Text("%.3f", s.last_ms); ImGui::NextColumn();
+                ImGui::Text("%.3f", s.average_ms); ImGui::NextColumn();
+                ImGui::Text("%.3f", s.max_ms); ImGui::NextColumn();
+                ImGui::Text("%llu", (unsigned long long)s.entities); ImGui::NextColumn();
+            }
+            ImGui::Columns(1);
+        }
+
+        void stores(const Monitor& monitor) {
+            ImGui::Columns(5, "stores");
+            ImGui::Text("component"); ImGui::NextColumn();
+            ImGui::Text("live"); ImGui::NextColumn();
+            ImGui::Text("capacity"); ImGui::NextColumn();
+            ImGui::Text("occupancy"); ImGui::NextColumn();
+            ImGui::Text("KiB"); ImGui::NextColumn();
+            ImGui::Separator();
+            for(const auto& s: monitor.series()) {
+                if(s.kind != Kind::store) continue;
+                ImGui::Text("%s", s.name.c_str()); ImGui::NextColumn();
+                ImGui::Text("%llu", (unsigned long long)s.entities); ImGui::NextColumn();
+                ImGui::Text("%llu", (unsigned long long)s.capacity); ImGui::NextColumn();
+                if(s.capacity) {
+                    ImGui::ProgressBar(float(s.entities) / float(s.capacity));
+                } else {
+                    ImGui::Text("-");
+                }
+                ImGui::NextColumn();
+                ImGui::Text("%.1f", double(s.bytes) / 1024.0); ImGui::NextColumn();
+            }
+            ImGui::Columns(1);
+        }
+    }
+#endif
+
+    void telemetry_panel(Monitor& monitor) {
+#if ECS_TELEMETRY
+        monitor.update();
+        ImGui::Begin("ECS Telemetry");
+        ImGui::Text("frame %llu, %llu samples dropped",
+            (unsigned long long)frame(), (unsigned long long)monitor.dropped());
+        if(ImGui::CollapsingHeader("Timings", ImGuiTreeNodeFlags_DefaultOpen)) timings(monitor);
+        if(ImGui::CollapsingHeader("Stores", ImGuiTreeNodeFlags_DefaultOpen)) stores(monitor);
+        ImGui::End();
+#else
+        (void)monitor;
+#endif
+    }
+}
@@ -0,0 +1,17 @@
+//===--------------------------------------------------------------------------------------------===
+// telemetry_panel.hpp - ImGui view of ECS telemetry
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#pragma once
+#include <ecs/telemetry.hpp>
+
+namespace amyinorbit {
+
+    // Drains [monitor] and draws the "ECS Telemetry" window: frame, system and query timings, and
+    // the occupancy of every component store. Draws nothing when telemetry is compiled out.
+    void telemetry_panel(ecs::telemetry::Monitor& monitor);
+}
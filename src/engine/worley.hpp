@@ -1,5 +1,5 @@
 //===--------------------------------------------------------------------------------------------===
-// worley.hpp - worley noise generator. !! very, very inefficient
+// worley.hpp - worley (cellular) noise generator
 //
 // Created by Amy Parent <amy@amyparent.com>
 // Copyright (c) 2019 Amy Parent
@@ -8,48 +8,130 @@
 //===--------------------------------------------------------------------------------------------===
 #pragma once
 #include <apmath/vector.hpp>
+#include <algorithm>
+#include <cstdint>
 #include <vector>
-#include <random>
 #include <cmath>
 #include <limits>
+#include "hash.hpp"
 
 namespace amyinorbit {
 
+    // Feature points live on a grid of cells, [freq] along each axis of [size] (rounded to a whole
+    // number), with [per_cell] points jittered inside each one. A sample only looks at the 3^D
+    // cells around it, and cell coordinates wrap around, so the pattern tiles every [size].
+    // Distances are in cells. Points are jittered over their whole cell, so neither F1 nor F2 is
+    // exact: near a cell corner, a point two cells away can, very rarely, be closer than every
+    // point in the 3^D cells searched. Such samples get a slightly too large distance.
+    // Feature points are hashed from [seed] and their cell, so the same seed always gives the
+    // same pattern, and each cell can be generated independently of the others.
     template <int D>
     class WorleyNoise {
     public:
         using vec = apm::vec<float, D>;
 
-        WorleyNoise(const vec& size, float freq)
-            : freq(freq), engine(std::random_device()()), size(size) {
-            int count = int(std::pow(freq, float(D)));
-            for(int i = 0; i < count; ++i) {
-                points.push_back(random_point());
+        // Distances to the closest (F1) and second closest (F2) feature points.
+        struct Distances {
+            float f1;
+            float f2;
+        };
+
+        WorleyNoise(const vec& size, float freq, std::uint32_t seed = 0, int per_cell = 1)
+            : cells(std::max(1, int(std::lround(freq))))
+            , per_cell(std::max(1, per_cell))
+            , size(size) {
+            std::size_t count = this->per_cell;
+            for(int i = 0; i < D; ++i) count *= cells;
+            points.resize(count);
+            for(std::size_t n = 0; n < count; ++n) points[n] = feature(seed, std::uint32_t(n));
+        }
+
+        // Position of the feature point with index [n] (cell * per_cell + k) within its cell.
+        static vec feature(std::uint32_t seed, std::uint32_t n) {
+            auto h = pcg_hash(pcg_hash(n) ^ seed);
+            vec p;
+            for(int i = 0; i < D; ++i) {
+                h = pcg_hash(h);
+                p[i] = unit_float(h);
             }
+            return p;
         }
 
-        float operator()(vec r) {
-            float dist = std::numeric_limits<float>::infinity();
+        // Read-only, so one generator can be shared by several threads.
+        float operator()(vec r) const {
+            return distances(r).f1;
+        }
+
+        Distances distances(vec r) const {
             r /= size;
-            for(const auto& p: points) {
-                auto d = apm::length(p-r) * freq;
-                if(d < dist) dist = d;
+
+            // For each axis and each of the three neighbouring cells along it (the sample's own
+            // first): that cell's part of the point index, the offset from the sample to the
+            // cell's corner, and the squared distance from the sample to the cell's slab.
+            std::size_t index[D][3];
+            float offset[D][3];
+            float bound[D][3];
+            std::size_t stride = 1;
+            for(int i = 0; i < D; ++i) {
+                float x = (r[i] - std::floor(r[i])) * cells;
+                int base = int(x);
+                float local = x - base;
+                for(int o = 0; o < 3; ++o) {
+                    int step = o == 0 ? 0 : o == 1 ? -1 : 1;
+                    index[i][o] = wrap(base + step) * stride;
+                    offset[i][o] = float(step) - local;
+                    float gap = step < 0 ? local : step > 0 ? 1 - local : 0;
+                    bound[i][o] = gap * gap;
+                }
+                stride *= cells;
             }
-            return dist;
+
+            float f1 = std::numeric_limits<float>::infinity();
+            float f2 = f1;
+            int digit[D] = {};
+            for(int n = 0; n < neighbours; ++n) {
+                std::size_t cell = 0;
+                float nearest = 0.f;
+                for(int i = 0; i < D; ++i) {
+                    cell += index[i][digit[i]];
+                    nearest += bound[i][digit[i]];
+                }
+
+                // Skip cells too far away to hold anything closer than F2.
+                if(nearest < f2) {
+                    const vec* p = points.data() + cell * per_cell;
+                    for(int k = 0; k < per_cell; ++k) {
+                        float d2 = 0.f;
+                        for(int i = 0; i < D; ++i) {
+                            float d = offset[i][digit[i]] + p[k][i];
+                            d2 += d * d;
+                        }
+                        if(d2 < f1) {
+                            f2 = f1;
+                            f1 = d2;
+                        } else if(d2 < f2) {
+                            f2 = d2;
+                        }
+                    }
+                }
+
+                for(int i = 0; i < D && ++digit[i] == 3; ++i) digit[i] = 0;
+            }
+            return Distances{std::sqrt(f1), std::sqrt(f2)};
         }
+
     private:
+        static constexpr int neighbours = D == 1 ? 3 : D == 2 ? 9 : D == 3 ? 27 : 81;
+        static_assert(D >= 1 && D <= 4, "worley noise supports 1 to 4 dimensions");
 
-        vec random_point() {
-            std::uniform_real_distribution<float> dist(0.f, 1.f);
-            vec v;
-            for(int i = 0; i < D; ++i) {
-                v[i] = dist(engine);
-            }
-            return v;
+        std::size_t wrap(int i) const {
+            i %= cells;
+            return std::size_t(i < 0 ? i + cells : i);
         }
-        float freq;
-        std::default_random_engine engine;
+
+        int cells;
+        int per_cell;
         vec size;
-        std::vector<vec> points;
+        std::vector<vec> points; // per_cell positions per cell, in [0, 1) of that cell
     };
 }
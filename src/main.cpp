@@ -1,5 +1,6 @@
 #include <glue/glue.hpp>
 #include <apmath/vector.hpp>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include "engine/assets_lib.hpp"
@@ -14,6 +15,15 @@ Context& GL() {
 }
 
 int main(int argc, const char** argv) {
+    bool rebake = false;
+    for(int i = 1; i < argc; ++i) {
+        if(!std::strcmp(argv[i], "--rebake")) {
+            rebake = true;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--rebake]\n";
+            return 1;
+        }
+    }
 
     Window::Attrib config;
     config.name = "Thermals";
@@ -22,7 +32,7 @@ int main(int argc, const char** argv) {
     config.is_fullscreen = false;
 
     try {
-        AssetsLib assets("assets");
+        AssetsLib assets("assets", rebake);
         app_main<CloudScene>(config, std::ref(assets));
     } catch(std::exception& e) {
         std::cerr << "fatal error: " << e.what() << "\n";
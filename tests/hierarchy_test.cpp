@@ -0,0 +1,63 @@
+//===--------------------------------------------------------------------------------------------===
+// hierarchy_test.cpp - Transform hierarchy regression tests
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <engine/hierarchy.hpp>
+#include <cstdio>
+#include <cstring>
+
+using namespace amyinorbit;
+
+namespace {
+    int failures = 0;
+
+    void check(bool ok, const char* what) {
+        if(ok) return;
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        failures += 1;
+    }
+
+    bool same(const mat4& a, const mat4& b) {
+        return std::memcmp(&a, &b, sizeof(mat4)) == 0;
+    }
+
+    // A detached child is a root again: its world matrix is its local one, and moving its old
+    // parent no longer moves it.
+    void detach_stops_following() {
+        ecs::World world;
+        TransformHierarchy hierarchy;
+
+        auto parent = world.create();
+        world.add_component<Transform>(parent).set_position(5.f, 0.f, 0.f);
+        auto child = world.create();
+        world.add_component<Transform>(child).set_position(1.f, 2.f, 3.f);
+        attach(world, child, parent);
+
+        hierarchy.run(world, 0.f);
+        const auto local = Transform(world.read<const Transform>(child)).transform();
+        check(!same(world.read<const WorldTransform>(child).matrix, local),
+              "attached child follows its parent");
+
+        world.advance();
+        detach(world, child);
+        world.get_component<Transform>(parent).set_position(10.f, 0.f, 0.f);
+        hierarchy.run(world, 0.f);
+        check(same(world.read<const WorldTransform>(child).matrix, local),
+              "detached child keeps its local matrix");
+
+        world.advance();
+        world.get_component<Transform>(parent).set_position(20.f, 0.f, 0.f);
+        hierarchy.run(world, 0.f);
+        check(same(world.read<const WorldTransform>(child).matrix, local),
+              "detached child ignores its old parent");
+    }
+}
+
+int main() {
+    detach_stops_following();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+//===--------------------------------------------------------------------------------------------===
+// snapshot_test.cpp - World snapshot regression tests
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/world.hpp>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+using namespace amyinorbit::ecs;
+
+struct Health { float value; };
+struct Unused { float value; };
+ECS_COMPONENT(Health, 0);
+ECS_COMPONENT(Unused, 1);
+
+namespace {
+    int failures = 0;
+
+    void check(bool ok, const char* what) {
+        if(ok) return;
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        failures += 1;
+    }
+
+    // The snapshot carries a store for Unused even though no entity has one. Restoring it into
+    // a world without that store must fail before the world is touched.
+    void missing_empty_store() {
+        World source;
+        source.prepare<Unused>();
+        auto saved = source.create();
+        source.add_component<Health>(saved, Health{10.f});
+        auto data = source.snapshot();
+
+        World target;
+        auto live = target.create();
+        target.add_component<Health>(live, Health{42.f});
+        target.create();
+
+        bool threw = false;
+        try {
+            target.restore(data);
+        } catch(const std::runtime_error&) {
+            threw = true;
+        }
+        check(threw, "restore without the store throws");
+        check(target.size() == 2, "entities survive a rejected restore");
+        check(target.is_valid(live) && target.has_component<Health>(live),
+              "components survive a rejected restore");
+        check(target.read<const Health>(live).value == 42.f, "values survive a rejected restore");
+        check(target.count<Health>() == 1, "queries survive a rejected restore");
+
+        target.prepare<Unused>();
+        target.restore(data);
+        check(target.size() == 1, "restore with every store succeeds");
+        check(target.read<const Health>(saved).value == 10.f, "restored values match");
+    }
+}
+
+int main() {
+    missing_empty_store();
+    return failures ? 1 : 0;
+}
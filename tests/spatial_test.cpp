@@ -0,0 +1,88 @@
+//===--------------------------------------------------------------------------------------------===
+// spatial_test.cpp - Spatial index regression tests
+//
+// Created by Amy Parent <amy@amyparent.com>
+// Copyright (c) 2020 Amy Parent
+// Licensed under the MIT License
+// =^•.•^=
+//===--------------------------------------------------------------------------------------------===
+#include <ecs/spatial.hpp>
+#include <cstdio>
+#include <vector>
+
+using namespace amyinorbit::ecs;
+
+struct Marker { Point at; };
+ECS_COMPONENT(Marker, 0);
+
+namespace amyinorbit::ecs {
+    template <> struct spatial_traits<Marker> {
+        static Point position(const Marker& m) { return m.at; }
+    };
+}
+
+namespace {
+    int failures = 0;
+
+    void check(bool ok, const char* backend, const char* what) {
+        if(ok) return;
+        std::fprintf(stderr, "FAILED: %s: %s\n", backend, what);
+        failures += 1;
+    }
+
+    template <typename Index>
+    std::vector<Entity> near(const Index& index, const Point& at) {
+        std::vector<Entity> found;
+        index.query(at, 1.f, [&](Entity e) { found.push_back(e); });
+        return found;
+    }
+
+    bool found(const std::vector<Entity>& entities, Entity e) {
+        for(auto other: entities) {
+            if(other.id == e.id && other.version == e.version) return true;
+        }
+        return false;
+    }
+
+    // One entity leaves and another joins in the same frame, so the number of entities with a
+    // Marker does not change: the leaver must still be dropped from the index.
+    template <typename Backend, typename... Args>
+    void swap_in_one_frame(const char* name, Args... args) {
+        World world;
+        SpatialIndex<Marker, Backend> index(args...);
+
+        auto a = world.create();
+        world.add_component<Marker>(a, Marker{{0.f, 0.f, 0.f}});
+        auto b = world.create();
+        world.add_component<Marker>(b, Marker{{10.f, 0.f, 0.f}});
+        index.update(world);
+        world.advance();
+
+        // Removal paired with an addition.
+        world.remove_component<Marker>(a);
+        auto c = world.create();
+        world.add_component<Marker>(c, Marker{{20.f, 0.f, 0.f}});
+        index.update(world);
+        world.advance();
+
+        check(index.size() == 2, name, "index holds the two entities with a Marker");
+        check(near(index, {0.f, 0.f, 0.f}).empty(), name, "removed component is dropped");
+        check(found(near(index, {20.f, 0.f, 0.f}), c), name, "added component is found");
+
+        // Destruction paired with a creation that recycles the id, with the Marker elsewhere.
+        world.destroy(b);
+        auto d = world.create();
+        world.add_component<Marker>(d, Marker{{30.f, 0.f, 0.f}});
+        index.update(world);
+
+        check(index.size() == 2, name, "index holds the two entities with a Marker");
+        check(near(index, {10.f, 0.f, 0.f}).empty(), name, "destroyed entity is dropped");
+        check(found(near(index, {30.f, 0.f, 0.f}), d), name, "recycled id is found");
+    }
+}
+
+int main() {
+    swap_in_one_frame<HashGrid>("hash grid", 4.f);
+    swap_in_one_frame<LooseOctree>("loose octree", Point{0.f, 0.f, 0.f}, 64.f, 4);
+    return failures ? 1 : 0;
+}